@@ -39,6 +39,22 @@ class Settings(BaseSettings):
     mqtt_username: str = ""
     mqtt_password: str = ""
     mqtt_topic: str = "braille/letter"
+    mqtt_cells_topic: str = "braille/cells"
+    mqtt_device_topic: str = "braille"        # <base>/<device id>/cells
+    mqtt_group_topic: str = "braille/group"   # <base>/<group>/cells
+    mqtt_telemetry_topic: str = "braille/telemetry"
+    mqtt_ack_topic: str = "braille/ack"
+    mqtt_lesson_status_topic: str = "braille/lesson/status"
+    mqtt_quiz_results_topic: str = "braille/quiz/results"
+    mqtt_local_topic: str = "braille/local"   # Devices announce their LAN address here
+
+    # Local link: direct WebSocket to displays on the same LAN, broker as fallback
+    local_link_enabled: bool = True
+    local_link_key: str = "12345678"   # Must match local_link_key in the firmware
+
+    # Synchronized playback: timed frames are shown this far after publishing,
+    # which must cover the slowest delivery through the broker
+    sync_lead_ms: int = 500
     
     class Config:
         env_file = ".env"
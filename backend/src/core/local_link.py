@@ -0,0 +1,159 @@
+"""Direct LAN WebSocket links to Braille displays (see esp32/include/local_link.h)."""
+
+import logging
+import struct
+import threading
+import time
+from typing import Callable, Dict, List, Optional
+
+from websockets.exceptions import WebSocketException
+from websockets.sync.client import connect
+
+logger = logging.getLogger(__name__)
+
+LOCAL_LINK_TOPIC_MAX = 63
+LOCAL_LINK_RETRY_SECONDS = 5.0
+LOCAL_LINK_OPEN_TIMEOUT = 2.0
+# Message kinds devices take over the link; the rest go through the broker
+LOCAL_LINK_KINDS = frozenset({"text", "grade2", "cells", "play", "quiz", "pace"})
+
+
+def local_link_accepts(topic: str) -> bool:
+    """True if the topic's kind (its last level) may go over a local link."""
+    return topic.rsplit("/", 1)[-1] in LOCAL_LINK_KINDS
+
+
+def encode_local_message(topic: str, payload: bytes) -> bytes:
+    """Topic length, topic and payload, as the device expects in one binary message."""
+    encoded = topic.encode()
+    if len(encoded) > LOCAL_LINK_TOPIC_MAX:
+        raise ValueError(f"Topic {topic} too long for the local link")
+    return struct.pack(">B", len(encoded)) + encoded + payload
+
+
+def decode_local_message(message: bytes):
+    """Split a device message into topic and payload; raises ValueError if malformed."""
+    if not message or message[0] + 1 > len(message):
+        raise ValueError(f"Malformed local link message ({len(message)} bytes)")
+    return message[1:1 + message[0]].decode(), message[1 + message[0]:]
+
+
+class LocalLinks:
+    """
+    One WebSocket per device that announced a LAN address.
+
+    Each link runs a reader thread that reconnects while the announcement
+    stands; messages from the device go to `on_message(topic, payload)`,
+    the same way broker messages do.
+    """
+
+    def __init__(self, key: str, on_message: Callable[[str, bytes], None]):
+        self.key = key
+        self.on_message = on_message
+        self.lock = threading.Lock()
+        self.links: Dict[str, "LocalLink"] = {}
+
+    def announce(self, device_id: str, host: str, port: int, group: str):
+        """Open (or re-point) the link to a device; called for each announcement."""
+        with self.lock:
+            link = self.links.get(device_id)
+            if link and (link.host, link.port) == (host, port):
+                link.group = group
+                return
+            if link:
+                link.close()
+            link = LocalLink(self, device_id, host, port, group)
+            self.links[device_id] = link
+        link.start()
+
+    def forget(self, device_id: str):
+        """Drop the link, e.g. when the device cleared its announcement."""
+        with self.lock:
+            link = self.links.pop(device_id, None)
+        if link:
+            link.close()
+
+    def connected(self, device_id: str) -> bool:
+        link = self.links.get(device_id)
+        return link is not None and link.connection is not None
+
+    def devices(self, group: Optional[str] = None) -> List[str]:
+        """Devices with an open link, optionally only those in one group."""
+        with self.lock:
+            return [d for d, link in self.links.items()
+                    if link.connection is not None and (group is None or link.group == group)]
+
+    def send(self, device_id: str, topic: str, payload: bytes) -> bool:
+        """Send one message over the device's link; False if it is not open or the kind is broker only."""
+        if not local_link_accepts(topic):
+            return False
+        link = self.links.get(device_id)
+        return link is not None and link.send(encode_local_message(topic, payload))
+
+    def close(self):
+        with self.lock:
+            links = list(self.links.values())
+            self.links.clear()
+        for link in links:
+            link.close()
+
+
+class LocalLink:
+    def __init__(self, owner: LocalLinks, device_id: str, host: str, port: int, group: str):
+        self.owner = owner
+        self.device_id = device_id
+        self.host = host
+        self.port = port
+        self.group = group
+        self.connection = None
+        self.closed = threading.Event()
+        self.thread = threading.Thread(target=self._run, name=f"local-link-{device_id}", daemon=True)
+
+    def start(self):
+        self.thread.start()
+
+    def close(self):
+        self.closed.set()
+        connection = self.connection
+        if connection:
+            connection.close()
+
+    def send(self, message: bytes) -> bool:
+        connection = self.connection
+        if connection is None:
+            return False
+        try:
+            connection.send(message)
+            return True
+        except (WebSocketException, OSError) as e:
+            logger.warning(f"Local link to {self.device_id} failed: {e}")
+            return False
+
+    def _run(self):
+        # The key goes in a header so it stays out of URLs and access logs
+        uri = f"ws://{self.host}:{self.port}/braille"
+        headers = {"Authorization": f"Bearer {self.owner.key}"}
+        while not self.closed.is_set():
+            try:
+                with connect(uri, additional_headers=headers, open_timeout=LOCAL_LINK_OPEN_TIMEOUT,
+                             compression=None, max_size=None) as connection:
+                    self.connection = connection
+                    logger.info(f"Local link to {self.device_id} at {self.host}:{self.port} open")
+                    for message in connection:
+                        if isinstance(message, bytes):
+                            self._dispatch(message)
+            except (WebSocketException, OSError) as e:
+                logger.debug(f"Local link to {self.device_id} unavailable: {e}")
+            finally:
+                if self.connection is not None:
+                    logger.info(f"Local link to {self.device_id} closed")
+                self.connection = None
+            self.closed.wait(LOCAL_LINK_RETRY_SECONDS)
+
+    def _dispatch(self, message: bytes):
+        try:
+            topic, payload = decode_local_message(message)
+        except ValueError as e:
+            logger.warning(f"Local link message from {self.device_id} ignored: {e}")
+            return
+        self.owner.on_message(topic, payload)
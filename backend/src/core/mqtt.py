@@ -1,10 +1,224 @@
 import paho.mqtt.client as mqtt
 import logging
+import struct
+import threading
 import time
+from collections import namedtuple
+from typing import Callable, Dict, Iterable, List, Optional, Tuple
 from src.config import get_settings
+from src.core.local_link import LocalLinks
+from src.utils.constants import BRAILLE_MAP
 
 logger = logging.getLogger(__name__)
 
+# Binary cell frame (see esp32/include/cell_frame.h)
+CELL_FRAME_VERSION = 1
+CELL_FRAME_FLAG_SYNC = 0x01
+CELL_FRAME_FLAG_TIMED = 0x02
+CELL_ACK_FORMAT = ">BBHH"
+CELL_ACK_FLAG_DROPPED = 0x01
+CELL_ACK_SCOPE_SHIFT = 1
+CELL_ACK_SCOPE_BROADCAST = 0
+CELL_ACK_SCOPE_GROUP = 1
+CELL_ACK_SCOPE_DEVICE = 2
+
+# Cached lessons (see esp32/include/lesson.h)
+LESSON_VERSION = 1
+LESSON_HEADER_FORMAT = ">BBIIH"
+LESSON_STEP_FORMAT = ">HH"
+LESSON_PLAY_FORMAT = ">BBIIHH"
+LESSON_PLAY_ALL = 0xFFFF
+LESSON_STATUS_FORMAT = ">BBII"
+LESSON_STATUS_STORED = 0
+LESSON_STATUS_PLAYING = 1
+LESSON_STATUS_MISS = 2
+LESSON_STATUS_INVALID = 3
+LESSON_MAX_SIZE = 4064  # One flash sector minus the slot header
+
+# Reading pace (see esp32/include/pace.h)
+PACE_VERSION = 1
+PACE_FORMAT = ">BBHHBBB"
+PACE_FLAG_ADAPTIVE = 0x01
+PACE_FLAG_OVERRIDE = 0x02
+PACE_NUDGES = {"faster": b"+", "slower": b"-", "reset": b"="}
+
+# Quizzes checked on the device (see esp32/include/quiz.h)
+QUIZ_VERSION = 1
+QUIZ_HEADER_FORMAT = ">BBIH"
+QUIZ_ITEM_FORMAT = ">BH"
+QUIZ_MAX_SIZE = 1024
+QUIZ_RESULTS_HEADER_FORMAT = ">BBIB"
+QUIZ_RESULT_FORMAT = ">HBH"
+QUIZ_RESULTS_FLAG_FINISHED = 0x01
+QUIZ_RESULT_CORRECT = 0x40
+QUIZ_RESULT_SKIPPED = 0x80
+
+# Device telemetry (see esp32/include/telemetry.h)
+TELEMETRY_VERSION = 1
+TELEMETRY_FORMAT = ">BBIIIIIHHHHHb"
+
+
+def cell_from_dots(dots: List[int]) -> int:
+    """Pack a BRAILLE_MAP dot list into the firmware's 6-bit cell (dot 1 = bit 5)."""
+    cell = 0
+    for i, raised in enumerate(dots):
+        if raised:
+            cell |= 1 << (5 - i)
+    return cell
+
+
+def cells_from_text(text: str) -> List[int]:
+    """Grade 1 cells for letters; anything else becomes a blank cell."""
+    return [cell_from_dots(BRAILLE_MAP[c]) if c in BRAILLE_MAP else 0 for c in text.lower()]
+
+
+def pack_cells(cells: List[int]) -> bytes:
+    """6-bit cells packed MSB first, 4 per 3 bytes."""
+    packed = bytearray()
+    acc = 0
+    bits = 0
+    for cell in cells:
+        acc = (acc << 6) | (cell & 0x3F)
+        bits += 6
+        while bits >= 8:
+            bits -= 8
+            packed.append((acc >> bits) & 0xFF)
+    if bits:
+        packed.append((acc << (8 - bits)) & 0xFF)
+    return bytes(packed)
+
+
+def encode_cell_frame(cells: Iterable[int], sequence: int, dwell_ms: int = 0, flags: int = 0,
+                      show_at_ms: Optional[int] = None) -> bytes:
+    """
+    Header (version, flags, sequence, dwell, count) followed by the packed cells.
+
+    With `show_at_ms` (Unix time in ms) devices show the first cell at that moment.
+    """
+    cells = list(cells)
+    if show_at_ms is not None:
+        flags |= CELL_FRAME_FLAG_TIMED
+    header = struct.pack(">BBHHH", CELL_FRAME_VERSION, flags, sequence & 0xFFFF, dwell_ms, len(cells))
+    if show_at_ms is not None:
+        header += struct.pack(">Q", show_at_ms)
+    return header + pack_cells(cells)
+
+
+def fnv1a(data: bytes) -> int:
+    """32-bit FNV-1a, the firmware's checksum and lesson version hash."""
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def encode_lesson_bundle(lesson_id: int, steps: List[List[int]], dwell_ms: int = 0) -> Tuple[bytes, int]:
+    """
+    Encode a whole lesson (one list of cells per step) for the device's flash cache.
+
+    Returns the bundle and its version hash, which changes whenever the steps do.
+    """
+    body = b"".join(struct.pack(LESSON_STEP_FORMAT, dwell_ms, len(step)) + pack_cells(step) for step in steps)
+    version_hash = fnv1a(body)
+    bundle = struct.pack(LESSON_HEADER_FORMAT, LESSON_VERSION, 0, lesson_id, version_hash, len(steps)) + body
+    if len(bundle) > LESSON_MAX_SIZE:
+        raise ValueError(f"Lesson {lesson_id} is {len(bundle)} bytes, the device caches at most {LESSON_MAX_SIZE}")
+    return bundle, version_hash
+
+
+def encode_lesson_play(lesson_id: int, version_hash: int, first_step: int = 0,
+                       step_count: int = LESSON_PLAY_ALL) -> bytes:
+    return struct.pack(LESSON_PLAY_FORMAT, LESSON_VERSION, 0, lesson_id, version_hash, first_step, step_count)
+
+
+def encode_pace(dwell_ms: int = 0, gap_ms: int = 0, speed_percent: int = 100, min_speed_percent: int = 100,
+                max_speed_percent: int = 100, adaptive: bool = False, override: bool = False) -> bytes:
+    """A learner's pace config; dwell 0 keeps the firmware default, nudges stay within min..max."""
+    flags = (PACE_FLAG_ADAPTIVE if adaptive else 0) | (PACE_FLAG_OVERRIDE if override else 0)
+    return struct.pack(PACE_FORMAT, PACE_VERSION, flags, dwell_ms, gap_ms, speed_percent,
+                       min_speed_percent, max_speed_percent)
+
+
+def encode_quiz(quiz_id: int, items: List[Tuple[List[int], int]]) -> bytes:
+    """
+    Encode a quiz of (prompt cells, expected answer cell) items.
+
+    An empty prompt shows nothing, for prompts the frontend speaks instead.
+    """
+    body = b"".join(struct.pack(QUIZ_ITEM_FORMAT, answer & 0x3F, len(prompt)) + pack_cells(prompt)
+                    for prompt, answer in items)
+    quiz = struct.pack(QUIZ_HEADER_FORMAT, QUIZ_VERSION, 0, quiz_id, len(items)) + body
+    if len(quiz) > QUIZ_MAX_SIZE:
+        raise ValueError(f"Quiz {quiz_id} is {len(quiz)} bytes, the device holds at most {QUIZ_MAX_SIZE}")
+    return quiz
+
+
+def decode_quiz_results(payload: bytes) -> dict:
+    """Decode a batch of quiz answers; raises ValueError on an unknown version or size."""
+    header_size = struct.calcsize(QUIZ_RESULTS_HEADER_FORMAT)
+    result_size = struct.calcsize(QUIZ_RESULT_FORMAT)
+    if len(payload) < header_size or payload[0] != QUIZ_VERSION:
+        raise ValueError(f"Unsupported quiz results payload ({len(payload)} bytes)")
+    _, flags, quiz_id, count = struct.unpack_from(QUIZ_RESULTS_HEADER_FORMAT, payload)
+    if len(payload) != header_size + count * result_size:
+        raise ValueError(f"Quiz results payload of {len(payload)} bytes does not hold {count} results")
+    results = []
+    for offset in range(header_size, len(payload), result_size):
+        item, answer, response_ms = struct.unpack_from(QUIZ_RESULT_FORMAT, payload, offset)
+        results.append({
+            "item": item,
+            "answer": answer & 0x3F,
+            "correct": bool(answer & QUIZ_RESULT_CORRECT),
+            "skipped": bool(answer & QUIZ_RESULT_SKIPPED),
+            "response_ms": response_ms,
+        })
+    return {"quiz_id": quiz_id, "finished": bool(flags & QUIZ_RESULTS_FLAG_FINISHED), "results": results}
+
+
+def decode_lesson_status(payload: bytes) -> dict:
+    """Decode a lesson status; raises ValueError on an unknown version or size."""
+    if len(payload) != struct.calcsize(LESSON_STATUS_FORMAT) or payload[0] != LESSON_VERSION:
+        raise ValueError(f"Unsupported lesson status payload ({len(payload)} bytes)")
+    _, status, lesson_id, version_hash = struct.unpack(LESSON_STATUS_FORMAT, payload)
+    return {"status": status, "lesson_id": lesson_id, "version_hash": version_hash}
+
+def decode_telemetry(payload: bytes) -> dict:
+    """Decode a telemetry message; raises ValueError on an unknown version or size."""
+    if len(payload) != struct.calcsize(TELEMETRY_FORMAT) or payload[0] != TELEMETRY_VERSION:
+        raise ValueError(f"Unsupported telemetry payload ({len(payload)} bytes)")
+    (_, _, uptime_s, free_heap, min_free_heap, network_loop_max_us, actuation_loop_max_us,
+     messages, interval_s, queue_depth, wifi_reconnects, mqtt_reconnects, rssi) = struct.unpack(
+        TELEMETRY_FORMAT, payload)
+    return {
+        "uptime_s": uptime_s,
+        "free_heap": free_heap,
+        "min_free_heap": min_free_heap,
+        "network_loop_max_us": network_loop_max_us,
+        "actuation_loop_max_us": actuation_loop_max_us,
+        "messages_per_s": messages / interval_s if interval_s else 0.0,
+        "queue_depth": queue_depth,
+        "wifi_reconnects": wifi_reconnects,
+        "mqtt_reconnects": mqtt_reconnects,
+        "rssi": rssi,
+    }
+
+def decode_cell_ack(payload: bytes) -> dict:
+    """Decode a display ack; raises ValueError on an unknown version or size."""
+    if len(payload) != struct.calcsize(CELL_ACK_FORMAT) or payload[0] != CELL_FRAME_VERSION:
+        raise ValueError(f"Unsupported ack payload ({len(payload)} bytes)")
+    _, flags, sequence, queue_free = struct.unpack(CELL_ACK_FORMAT, payload)
+    return {"flags": flags, "scope": (flags >> CELL_ACK_SCOPE_SHIFT) & 0x03,
+            "sequence": sequence, "queue_free": queue_free}
+
+
+# Messages that arrive over a local link, shaped like paho's for the same handlers
+LocalMessage = namedtuple("LocalMessage", ["topic", "payload"])
+
+
+def sequence_after(a: int, b: int) -> bool:
+    """16-bit serial-number comparison: True if a is newer than b."""
+    return 0 < ((a - b) & 0xFFFF) < 0x8000
+
 class LetterPublisher:
     def __init__(self):
         settings = get_settings()
@@ -13,6 +227,26 @@ class LetterPublisher:
         self.username = settings.mqtt_username
         self.password = settings.mqtt_password
         self.topic = settings.mqtt_topic
+        self.cells_topic = settings.mqtt_cells_topic
+        self.telemetry_topic = settings.mqtt_telemetry_topic
+        self.ack_topic = settings.mqtt_ack_topic
+        self.device_topic = settings.mqtt_device_topic
+        self.group_topic = settings.mqtt_group_topic
+        self.lesson_status_topic = settings.mqtt_lesson_status_topic
+        self.local_topic = settings.mqtt_local_topic
+        self.quiz_results_topic = settings.mqtt_quiz_results_topic
+        self.sync_lead_ms = settings.sync_lead_ms
+        self.local_link_enabled = settings.local_link_enabled
+        # Direct LAN links to devices that announced one; the broker is the fallback
+        self.local = LocalLinks(settings.local_link_key, self.on_local_message)
+        self.lessons: Dict[int, Tuple[bytes, int]] = {}  # Registered bundles and hashes by lesson id
+        self.sequences: Dict[str, int] = {}  # Next frame sequence per cells topic
+        # Display acks (see publish_cells_windowed), keyed by ack_key()
+        self.ack_condition = threading.Condition()
+        self.acked_sequences: Dict[Tuple[int, Optional[str]], int] = {}  # Newest frame reported as shown
+        self.dropped_sequences: Dict[Tuple[int, Optional[str]], set] = {}
+        self.telemetry: Dict[str, dict] = {}  # Latest sample per device id
+        self.quiz_result_handlers: List[Callable[[str, dict], None]] = []
         
         self.client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2, client_id="BraillePublisher")
         
@@ -23,6 +257,11 @@ class LetterPublisher:
         self.client.on_connect = self.on_connect
         self.client.on_disconnect = self.on_disconnect
         self.client.on_publish = self.on_publish
+        self.client.message_callback_add(f"{self.telemetry_topic}/+", self.on_telemetry)
+        self.client.message_callback_add(f"{self.ack_topic}/+", self.on_ack)
+        self.client.message_callback_add(f"{self.lesson_status_topic}/+", self.on_lesson_status)
+        self.client.message_callback_add(f"{self.quiz_results_topic}/+", self.on_quiz_results)
+        self.client.message_callback_add(f"{self.local_topic}/+", self.on_local_announce)
         
         self.connected = False
 
@@ -30,6 +269,12 @@ class LetterPublisher:
         if reason_code == 0:
             logger.info("Connected to MQTT Broker")
             self.connected = True
+            client.subscribe(f"{self.telemetry_topic}/+")
+            client.subscribe(f"{self.ack_topic}/+")
+            client.subscribe(f"{self.lesson_status_topic}/+")
+            client.subscribe(f"{self.quiz_results_topic}/+")
+            if self.local_link_enabled:
+                client.subscribe(f"{self.local_topic}/+")
         else:
             logger.error(f"Failed to connect to MQTT Broker with code {reason_code}")
             self.connected = False
@@ -41,6 +286,175 @@ class LetterPublisher:
     def on_publish(self, client, userdata, mid, reason_code, properties):
         logger.debug(f"Message published (ID: {mid})")
 
+    def on_telemetry(self, client, userdata, message):
+        device_id = message.topic.rsplit("/", 1)[-1]
+        try:
+            sample = decode_telemetry(message.payload)
+        except ValueError as e:
+            logger.warning(f"Telemetry from {device_id} ignored: {e}")
+            return
+        sample["received_at"] = time.time()
+        self.telemetry[device_id] = sample
+        logger.debug(f"Telemetry from {device_id}: {sample}")
+
+    def on_ack(self, client, userdata, message):
+        try:
+            ack = decode_cell_ack(message.payload)
+        except ValueError as e:
+            logger.warning(f"Ack on {message.topic} ignored: {e}")
+            return
+        device_id = message.topic.rsplit("/", 1)[-1]
+        key = (ack["scope"], device_id if ack["scope"] == CELL_ACK_SCOPE_DEVICE else None)
+        with self.ack_condition:
+            acked = self.acked_sequences.get(key)
+            if ack["flags"] & CELL_ACK_FLAG_DROPPED:
+                self.dropped_sequences.setdefault(key, set()).add(ack["sequence"])
+            elif acked is None or sequence_after(ack["sequence"], acked):
+                self.acked_sequences[key] = ack["sequence"]
+            self.ack_condition.notify_all()
+
+    def on_lesson_status(self, client, userdata, message):
+        device_id = message.topic.rsplit("/", 1)[-1]
+        try:
+            status = decode_lesson_status(message.payload)
+        except ValueError as e:
+            logger.warning(f"Lesson status from {device_id} ignored: {e}")
+            return
+        lesson = self.lessons.get(status["lesson_id"])
+        if status["status"] == LESSON_STATUS_MISS and lesson and lesson[1] == status["version_hash"]:
+            # The device keeps the missed play and starts it once the bundle is cached
+            logger.info(f"Lesson {status['lesson_id']} not cached on {device_id}, sending bundle")
+            self._publish(self.topic_for("lesson", device_id=device_id), lesson[0], device_id=device_id)
+        elif status["status"] == LESSON_STATUS_INVALID:
+            logger.error(f"Device {device_id} rejected lesson {status['lesson_id']}")
+
+    def on_quiz_results(self, client, userdata, message):
+        device_id = message.topic.rsplit("/", 1)[-1]
+        try:
+            batch = decode_quiz_results(message.payload)
+        except ValueError as e:
+            logger.warning(f"Quiz results from {device_id} ignored: {e}")
+            return
+        logger.debug(f"Quiz {batch['quiz_id']} results from {device_id}: {len(batch['results'])}")
+        for handler in self.quiz_result_handlers:
+            handler(device_id, batch)
+
+    def on_local_announce(self, client, userdata, message):
+        """Retained "<ip> <port> <group>" from each device; empty once it is withdrawn."""
+        device_id = message.topic.rsplit("/", 1)[-1]
+        if not message.payload:
+            logger.info(f"Local link of {device_id} withdrawn")
+            self.local.forget(device_id)
+            return
+        try:
+            host, port, group = message.payload.decode().split(" ", 2)
+            port = int(port)
+        except ValueError:
+            logger.warning(f"Malformed local link announcement from {device_id}")
+            self.local.forget(device_id)
+            return
+        self.local.announce(device_id, host, port, group)
+
+    def on_local_message(self, topic: str, payload: bytes):
+        """Device replies over a local link go to the same handlers as broker messages."""
+        message = LocalMessage(topic, payload)
+        if topic.startswith(f"{self.ack_topic}/"):
+            self.on_ack(None, None, message)
+        elif topic.startswith(f"{self.lesson_status_topic}/"):
+            self.on_lesson_status(None, None, message)
+        elif topic.startswith(f"{self.telemetry_topic}/"):
+            self.on_telemetry(None, None, message)
+        elif topic.startswith(f"{self.quiz_results_topic}/"):
+            self.on_quiz_results(None, None, message)
+
+    def reachable(self, device_id: Optional[str] = None) -> bool:
+        return self.connected or (device_id is not None and self.local.connected(device_id))
+
+    def topic_for(self, kind: str, device_id: Optional[str] = None, group: Optional[str] = None) -> str:
+        """Topic of a message kind for one device, one group, or (neither given) every device."""
+        if device_id:
+            return f"{self.device_topic}/{device_id}/{kind}"
+        if group:
+            return f"{self.group_topic}/{group}/{kind}"
+        return f"{self.device_topic}/{kind}"
+
+    def cells_topic_for(self, device_id: Optional[str] = None, group: Optional[str] = None) -> str:
+        """Cells topic for one device, one group, or (neither given) every device."""
+        if device_id or group:
+            return self.topic_for("cells", device_id, group)
+        return self.cells_topic
+
+    def register_lesson(self, lesson_id: int, steps: List[List[int]], dwell_ms: int = 0) -> int:
+        """Encode a lesson once so devices can be sent it on a cache miss; returns its version hash."""
+        bundle, version_hash = encode_lesson_bundle(lesson_id, steps, dwell_ms)
+        self.lessons[lesson_id] = (bundle, version_hash)
+        return version_hash
+
+    def play_lesson(self, lesson_id: int, first_step: int = 0, step_count: int = LESSON_PLAY_ALL,
+                    device_id: Optional[str] = None, group: Optional[str] = None) -> bool:
+        """
+        Play steps of a registered lesson from the devices' flash cache.
+
+        Only the 14-byte play command goes out; a device that lacks this version of the
+        lesson answers with a miss and gets the bundle once (see on_lesson_status).
+        """
+        if not self.reachable(device_id):
+            logger.error("Cannot publish: Not connected to MQTT Broker")
+            return False
+        _, version_hash = self.lessons[lesson_id]
+        if not self._publish(self.topic_for("play", device_id, group),
+                             encode_lesson_play(lesson_id, version_hash, first_step, step_count), device_id):
+            logger.error("Failed to publish lesson play")
+            return False
+        return True
+
+    def start_quiz(self, quiz_id: int, items: List[Tuple[List[int], int]], device_id: Optional[str] = None,
+                   group: Optional[str] = None) -> bool:
+        """
+        Send a quiz with its expected answers; the devices check each answer on
+        their keys and report the results in batches to quiz_result_handlers.
+        """
+        if not self.reachable(device_id):
+            logger.error("Cannot publish: Not connected to MQTT Broker")
+            return False
+        if not self._publish(self.topic_for("quiz", device_id, group), encode_quiz(quiz_id, items),
+                             device_id, group):
+            logger.error("Failed to publish quiz")
+            return False
+        return True
+
+    def set_pace(self, device_id: str, **pace) -> bool:
+        """
+        Set one learner's reading pace (see encode_pace for the fields).
+
+        Retained on the device's pace topic, so the display gets it back on every
+        reconnect; resending the same config keeps the learner's nudges.
+        """
+        payload = encode_pace(**pace)
+        topic = self.topic_for("pace", device_id=device_id)
+        sent_locally = self.local.send(device_id, topic, payload)
+        if not self.connected:
+            return sent_locally
+        result = self.client.publish(topic, payload, qos=1, retain=True)
+        return sent_locally or result.rc == mqtt.MQTT_ERR_SUCCESS
+
+    def nudge_pace(self, device_id: str, nudge: str) -> bool:
+        """Learner input: "faster", "slower" or "reset" to the configured speed."""
+        if not self.reachable(device_id):
+            logger.error("Cannot publish: Not connected to MQTT Broker")
+            return False
+        return self._publish(self.topic_for("pace", device_id=device_id), PACE_NUDGES[nudge], device_id)
+
+    @staticmethod
+    def ack_key(device_id: Optional[str] = None, group: Optional[str] = None):
+        """
+        Acks are tracked per scope; device acks also per device. Group and
+        broadcast frames count as shown once any device acks them, like before.
+        """
+        if device_id:
+            return (CELL_ACK_SCOPE_DEVICE, device_id)
+        return (CELL_ACK_SCOPE_GROUP if group else CELL_ACK_SCOPE_BROADCAST, None)
+
     def connect(self):
         logger.info(f"Connecting to MQTT Broker at {self.broker}:{self.port}...")
         try:
@@ -62,6 +476,7 @@ class LetterPublisher:
             return False
 
     def disconnect(self):
+        self.local.close()
         self.client.loop_stop()
         self.client.disconnect()
 
@@ -83,5 +498,125 @@ class LetterPublisher:
             logger.error(f"Error publishing letter: {e}")
             return False
 
+    def show_at_ms(self) -> int:
+        """Show-at time for a synchronized frame: far enough ahead for every copy to arrive."""
+        return int(time.time() * 1000) + self.sync_lead_ms
+
+    def publish_cells(self, cells: List[int], dwell_ms: int = 0, device_id: Optional[str] = None,
+                      group: Optional[str] = None, synchronized: bool = False) -> bool:
+        """
+        Publish a batch of cells as one binary frame instead of one message per letter.
+
+        Goes to every device unless `device_id` or `group` picks a single unit or classroom.
+        `synchronized` has every device raise the first cell at the same moment
+        (they keep SNTP time), sync_lead_ms from now.
+        """
+        if not self.reachable(device_id):
+            logger.error("Cannot publish: Not connected to MQTT Broker")
+            return False
+
+        try:
+            topic = self.cells_topic_for(device_id, group)
+            show_at = self.show_at_ms() if synchronized else None
+            _, sent = self._publish_frame(topic, cells, dwell_ms, device_id, group, wait=True, show_at_ms=show_at)
+            if sent:
+                logger.info(f"Sent {len(cells)} cells to {topic}")
+                return True
+            else:
+                logger.error("Failed to publish cells")
+                return False
+        except Exception as e:
+            logger.error(f"Error publishing cells: {e}")
+            return False
+
+    def publish_cells_windowed(self, cells: List[int], dwell_ms: int = 0, frame_cells: int = 16,
+                               window: int = 4, ack_timeout: float = 10.0, device_id: Optional[str] = None,
+                               group: Optional[str] = None, synchronized: bool = False) -> bool:
+        """
+        Publish cells as several frames, keeping up to `window` frames in flight.
+
+        A frame counts as done once a device acks it as shown (cumulative), so the
+        next frames are already queued on the device while the current ones play.
+        With `synchronized` only the first frame is timed; devices started together
+        stay together on their own dwell timers.
+        Returns False if a frame was dropped by the device or an ack timed out.
+        """
+        if not self.reachable(device_id):
+            logger.error("Cannot publish: Not connected to MQTT Broker")
+            return False
+
+        topic = self.cells_topic_for(device_id, group)
+        key = self.ack_key(device_id, group)
+        in_flight = []
+        for start in range(0, len(cells), frame_cells):
+            if not self._wait_for_acks(key, in_flight, window - 1, ack_timeout):
+                return False
+            show_at = self.show_at_ms() if synchronized and start == 0 else None
+            sequence, sent = self._publish_frame(topic, cells[start:start + frame_cells], dwell_ms,
+                                                 device_id, group, show_at_ms=show_at)
+            if not sent:
+                logger.error("Failed to publish cells")
+                return False
+            in_flight.append(sequence)
+
+        if not self._wait_for_acks(key, in_flight, 0, ack_timeout):
+            return False
+        logger.info(f"Sent {len(cells)} cells to {topic} in windowed frames")
+        return True
+
+    def _publish_frame(self, topic: str, cells: List[int], dwell_ms: int, device_id: Optional[str] = None,
+                       group: Optional[str] = None, wait: bool = False, show_at_ms: Optional[int] = None):
+        """Encode and publish the next frame; returns its sequence and whether it went out."""
+        # Each topic is sequenced on its own; the first frame of this process
+        # on a topic tells devices to resync
+        sequence = self.sequences.get(topic, 0)
+        flags = CELL_FRAME_FLAG_SYNC if sequence == 0 else 0
+        frame = encode_cell_frame(cells, sequence, dwell_ms, flags, show_at_ms)
+        self.sequences[topic] = (sequence + 1) & 0xFFFF
+        return sequence, self._publish(topic, frame, device_id, group, sequenced=True, wait=wait)
+
+    def _publish(self, topic: str, payload: bytes, device_id: Optional[str] = None, group: Optional[str] = None,
+                 sequenced: bool = False, wait: bool = False) -> bool:
+        """
+        Send over the device's local link when it has one, else through the broker at QoS 1.
+
+        Sequenced cell frames for a group or every device also go over each matching
+        local link; devices drop whichever copy arrives second as a duplicate.
+        """
+        if device_id and self.local.send(device_id, topic, payload):
+            return True
+        sent_locally = False
+        if sequenced and not device_id:
+            for local_device in self.local.devices(group):
+                sent_locally |= self.local.send(local_device, topic, payload)
+        if not self.connected:
+            return sent_locally
+        result = self.client.publish(topic, payload, qos=1)
+        if wait:
+            result.wait_for_publish(timeout=2)
+        return sent_locally or result.rc == mqtt.MQTT_ERR_SUCCESS
+
+    def _wait_for_acks(self, key, in_flight: List[int], limit: int, timeout: float) -> bool:
+        """Block until at most `limit` of the in-flight frames are unacknowledged."""
+        deadline = time.time() + timeout
+        with self.ack_condition:
+            while True:
+                dropped_set = self.dropped_sequences.get(key, set())
+                dropped = dropped_set.intersection(in_flight)
+                if dropped:
+                    logger.error(f"Device dropped cell frame(s) {sorted(dropped)}: queue full")
+                    dropped_set.difference_update(dropped)
+                    return False
+                acked = self.acked_sequences.get(key)
+                if acked is not None:
+                    in_flight[:] = [s for s in in_flight if sequence_after(s, acked)]
+                if len(in_flight) <= limit:
+                    return True
+                remaining = deadline - time.time()
+                if remaining <= 0:
+                    logger.error(f"Timed out waiting for display ack of frame(s) {in_flight}")
+                    return False
+                self.ack_condition.wait(remaining)
+
 # Global instance
 publisher = LetterPublisher()
@@ -4,6 +4,8 @@ from pydantic import BaseModel, Field, validator
 from typing import List, Dict, Optional
 from datetime import datetime
 
+from src.utils.constants import BRAILLE_MAP
+
 
 # ============================================================================
 # Learning Engine Models
@@ -43,6 +45,22 @@ class AttemptRequest(BaseModel):
         return v.strip()
 
 
+class QuizStartRequest(BaseModel):
+    """Request to run a quiz on the learner's display, answered on its dot keys."""
+    user_id: str = Field(..., min_length=1)
+    device_id: str = Field(..., min_length=1, description="Display the learner uses (MAC based id)")
+    letters: List[str] = Field(..., min_length=1, max_length=64)
+    show_prompt: bool = Field(True, description="Show each letter; off when the frontend speaks it")
+    session_id: Optional[str] = None
+
+    @validator('letters', each_item=True)
+    def validate_letter(cls, v):
+        v = v.strip().lower()
+        if v not in BRAILLE_MAP:
+            raise ValueError(f"Invalid letter: '{v}'. Must be a-z")
+        return v
+
+
 class AttemptResult(BaseModel):
     """Result of a learning attempt."""
     success: bool
@@ -1,5 +1,6 @@
 from fastapi import APIRouter, HTTPException, status
 from pydantic import BaseModel, Field, field_validator
+from typing import Literal
 import logging
 from src.core.mqtt import publisher
 
@@ -16,6 +17,29 @@ class LetterRequest(BaseModel):
             raise ValueError('Must be a single letter A-Z')
         return v.upper()
 
+class PaceRequest(BaseModel):
+    device_id: str = Field(..., description="Display the learner uses (MAC based id)")
+    dwell_ms: int = Field(0, ge=0, le=65535, description="Per cell, 0 for the firmware default")
+    gap_ms: int = Field(0, ge=0, le=65535, description="Dots down between lines")
+    speed_percent: int = Field(100, ge=10, le=250)
+    min_speed_percent: int = Field(100, ge=10, le=250)
+    max_speed_percent: int = Field(100, ge=10, le=250)
+    adaptive: bool = Field(False, description="Let the learner nudge the speed")
+    override: bool = Field(False, description="Also replace the dwell of lessons and cell frames")
+
+    @field_validator('max_speed_percent')
+    @classmethod
+    def validate_range(cls, v, info):
+        low = info.data.get('min_speed_percent', 100)
+        speed = info.data.get('speed_percent', 100)
+        if not low <= speed <= v:
+            raise ValueError('Must satisfy min_speed_percent <= speed_percent <= max_speed_percent')
+        return v
+
+class PaceNudgeRequest(BaseModel):
+    device_id: str
+    nudge: Literal["faster", "slower", "reset"]
+
 class SuccessResponse(BaseModel):
     success: bool
     message: str
@@ -47,3 +71,47 @@ async def send_letter(request: LetterRequest):
         message=f"Letter '{request.letter}' sent to Braille display",
         data={"letter": request.letter}
     )
+
+@router.get("/telemetry")
+async def get_telemetry():
+    """Latest telemetry sample reported by each Braille display, keyed by device id."""
+    return publisher.telemetry
+
+@router.post("/pace", response_model=SuccessResponse, status_code=status.HTTP_200_OK)
+async def set_pace(request: PaceRequest):
+    """
+    Set a learner's reading pace; the display times cells itself from then on.
+    """
+    if not publisher.reachable(request.device_id):
+        raise HTTPException(
+            status_code=status.HTTP_503_SERVICE_UNAVAILABLE,
+            detail="MQTT broker not connected"
+        )
+
+    pace = request.model_dump(exclude={"device_id"})
+    if not publisher.set_pace(request.device_id, **pace):
+        raise HTTPException(
+            status_code=status.HTTP_500_INTERNAL_SERVER_ERROR,
+            detail="Failed to publish pace"
+        )
+
+    return SuccessResponse(
+        success=True,
+        message=f"Pace set for {request.device_id}",
+        data=pace
+    )
+
+@router.post("/pace/nudge", response_model=SuccessResponse, status_code=status.HTTP_200_OK)
+async def nudge_pace(request: PaceNudgeRequest):
+    """Learner asks for faster or slower reading, within the range set with /pace."""
+    if not publisher.nudge_pace(request.device_id, request.nudge):
+        raise HTTPException(
+            status_code=status.HTTP_503_SERVICE_UNAVAILABLE,
+            detail="Display not reachable"
+        )
+
+    return SuccessResponse(
+        success=True,
+        message=f"Pace nudged {request.nudge}",
+        data={"nudge": request.nudge}
+    )
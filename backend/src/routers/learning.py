@@ -1,21 +1,37 @@
 """Learning router - adaptive learning endpoints."""
 
 from fastapi import APIRouter, HTTPException, Depends
+import asyncio
 import logging
+import secrets
+import time
+from typing import Dict, List
 
 from src.models.schemas import (
     LearningStepRequest,
     LearningStepRequest,
     AttemptRequest,
     TimeUpdateRequest,
+    QuizStartRequest,
 
 )
 from src.services import LearningService
+from src.repositories import LearningRepository
+from src.config.database import get_database
+from src.config.settings import get_settings
 from src.core.dependencies import get_learning_service
+from src.core.mqtt import publisher, cell_from_dots
+from src.utils.constants import BRAILLE_MAP
 
 logger = logging.getLogger(__name__)
+settings = get_settings()
 router = APIRouter(prefix="/api/learning", tags=["Learning Engine"])
 
+# Quizzes running on displays, by quiz id. The device checks each answer
+# itself; results come back in batches on the MQTT thread.
+quizzes: Dict[int, dict] = {}
+CELL_LETTERS = {cell_from_dots(dots): letter for letter, dots in BRAILLE_MAP.items()}
+
 
 @router.post("/step")
 async def get_learning_step(
@@ -69,6 +85,68 @@ async def update_time(
 
 
 
+@router.post("/quiz")
+async def start_quiz(req: QuizStartRequest):
+    """
+    Run a quiz on the learner's display.
+
+    The learner writes each letter on the display's dot keys; the device checks the
+    answer against the expected cell and moves on at once. Attempts are recorded
+    as the device reports them, a batch at a time.
+    """
+    now = time.time()
+    for stale in [q for q, quiz in quizzes.items() if now - quiz["started_at"] > settings.session_timeout]:
+        del quizzes[stale]
+
+    quiz_id = secrets.randbits(32)
+    items = [([cell_from_dots(BRAILLE_MAP[l])] if req.show_prompt else [], cell_from_dots(BRAILLE_MAP[l]))
+             for l in req.letters]
+    quizzes[quiz_id] = {
+        "user_id": req.user_id,
+        "device_id": req.device_id,
+        "letters": req.letters,
+        "session_id": req.session_id,
+        "started_at": now,
+        "loop": asyncio.get_running_loop(),
+    }
+    if not publisher.start_quiz(quiz_id, items, device_id=req.device_id):
+        del quizzes[quiz_id]
+        raise HTTPException(status_code=503, detail="Braille display not reachable")
+    return {"quiz_id": quiz_id, "letters": req.letters}
+
+
+def _on_quiz_results(device_id: str, batch: dict):
+    """Runs on the MQTT or local link thread; attempts are recorded on the app's loop."""
+    quiz = quizzes.get(batch["quiz_id"])
+    if not quiz or quiz["device_id"] != device_id:
+        return
+    if batch["finished"]:
+        del quizzes[batch["quiz_id"]]
+    asyncio.run_coroutine_threadsafe(_record_quiz_results(quiz, batch["results"]), quiz["loop"])
+
+
+async def _record_quiz_results(quiz: dict, results: List[dict]):
+    service = LearningService(LearningRepository(get_database()))
+    for result in results:
+        if result["item"] >= len(quiz["letters"]):
+            continue
+        # A skip, or a chord that is no letter, counts as a wrong answer
+        written = "?" if result["skipped"] else CELL_LETTERS.get(result["answer"], "?")
+        try:
+            await service.process_attempt(
+                user_id=quiz["user_id"],
+                target_letter=quiz["letters"][result["item"]],
+                spoken_letter=written,
+                response_time=result["response_ms"] / 1000,
+                session_id=quiz["session_id"]
+            )
+        except Exception as e:
+            logger.error(f"Error recording quiz attempt: {e}")
+
+
+publisher.quiz_result_handlers.append(_on_quiz_results)
+
+
 @router.get("/stats/{user_id}")
 async def get_user_stats(
     user_id: str,
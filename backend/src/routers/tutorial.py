@@ -10,7 +10,7 @@ from src.models.schemas import TutorialStartRequest, TutorialControlRequest
 from src.utils.constants import BRAILLE_MAP, ALPHABET
 from src.utils.helpers import explain_letter
 from src.config.settings import get_settings
-from src.core.mqtt import publisher
+from src.core.mqtt import publisher, cell_from_dots
 
 logger = logging.getLogger(__name__)
 settings = get_settings()
@@ -22,6 +22,11 @@ tutorial_sessions = {}
 session_lock = Lock()
 last_cleanup_time = time.time()
 
+# The alphabet is cached on the displays as a lesson with one letter per step,
+# so each tutorial step only sends a short play command
+ALPHABET_LESSON_ID = 1
+publisher.register_lesson(ALPHABET_LESSON_ID, [[cell_from_dots(BRAILLE_MAP[l])] for l in ALPHABET])
+
 
 def cleanup_old_sessions():
     """Remove tutorial sessions older than SESSION_TIMEOUT."""
@@ -87,9 +92,9 @@ def get_current_step(tutorial_id: str):
     
     letter = ALPHABET[session["index"]]
     
-    # Send letter to MQTT broker for Braille display
+    # Show the letter on the Braille display from its lesson cache
     if publisher.connected:
-        publisher.publish_letter(letter.upper())
+        publisher.play_lesson(ALPHABET_LESSON_ID, first_step=session["index"], step_count=1)
     else:
         logger.warning("MQTT not connected, skipping letter publish")
 
@@ -133,9 +138,9 @@ def next_letter(req: TutorialControlRequest):
 
     letter = ALPHABET[session["index"]]
     
-    # Send letter to MQTT broker for Braille display
+    # Show the letter on the Braille display from its lesson cache
     if publisher.connected:
-        publisher.publish_letter(letter.upper())
+        publisher.play_lesson(ALPHABET_LESSON_ID, first_step=session["index"], step_count=1)
     else:
         logger.warning("MQTT not connected, skipping letter publish")
 
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Braille Cell Encoding =====
+// A cell is a 6-bit pattern, 1 = raised (active), 0 = lowered (inactive).
+// Dot 1 is bit 5 and dot 6 is bit 0, matching braillePatterns below:
+//   1 • • 4
+//   2 • • 5
+//   3 • • 6
+constexpr uint8_t dots(const char* numbers) {
+  uint8_t pattern = 0;
+  for (; *numbers; numbers++) {
+    pattern |= 1 << (6 - (*numbers - '0'));
+  }
+  return pattern;
+}
+
+constexpr uint8_t BRAILLE_CAPITAL_SIGN = dots("6");
+constexpr uint8_t BRAILLE_NUMBER_SIGN = dots("3456");
+constexpr uint8_t BRAILLE_LETTER_SIGN = dots("56");   // Grade 1 indicator: a-j after digits
+
+// ===== Braille Pattern Mapping (6-dot) =====
+// Each letter A-Z mapped to its 6-bit pattern
+constexpr uint8_t braillePatterns[26] = {
+  0b100000,  // A: dot 1
+  0b110000,  // B: dots 1,2
+  0b100100,  // C: dots 1,4
+  0b100110,  // D: dots 1,4,5
+  0b100010,  // E: dots 1,5
+  0b110100,  // F: dots 1,2,4
+  0b110110,  // G: dots 1,2,4,5
+  0b110010,  // H: dots 1,2,5
+  0b010100,  // I: dots 2,4
+  0b010110,  // J: dots 2,4,5
+  0b101000,  // K: dots 1,3
+  0b111000,  // L: dots 1,2,3
+  0b101100,  // M: dots 1,3,4
+  0b101110,  // N: dots 1,3,4,5
+  0b101010,  // O: dots 1,3,5
+  0b111100,  // P: dots 1,2,3,4
+  0b111110,  // Q: dots 1,2,3,4,5
+  0b111010,  // R: dots 1,2,3,5
+  0b011100,  // S: dots 2,3,4
+  0b011110,  // T: dots 2,3,4,5
+  0b101001,  // U: dots 1,3,6
+  0b111001,  // V: dots 1,2,3,6
+  0b010111,  // W: dots 2,4,5,6
+  0b101101,  // X: dots 1,3,4,6
+  0b101111,  // Y: dots 1,3,4,5,6
+  0b101011   // Z: dots 1,3,5,6
+};
+
+static_assert(braillePatterns['D' - 'A'] == dots("145"), "dots() must match braillePatterns bit order");
+static_assert(braillePatterns['W' - 'A'] == dots("2456"), "dots() must match braillePatterns bit order");
+
+// ===== Byte to Cell Lookup Table =====
+// One entry per input byte, generated at compile time and kept in flash.
+// Capitals and digits carry their indicator as cells[0]; the translator
+// drops it where it is redundant (capitals disabled, digit runs).
+enum BrailleEntryFlags : uint8_t {
+  BRAILLE_FLAG_CAPITAL  = 1 << 0,  // cells[0] is the capital sign
+  BRAILLE_FLAG_DIGIT    = 1 << 1,  // cells[0] is the number sign
+  BRAILLE_FLAG_A_TO_J   = 1 << 2,  // Reads as a digit right after a number
+  BRAILLE_FLAG_UNMAPPED = 1 << 3,  // Printable, but no braille symbol: shown blank
+};
+
+struct BrailleEntry {
+  uint8_t len;       // Cells to emit, 0 = byte is ignored (control, UTF-8)
+  uint8_t flags;
+  uint8_t cells[2];
+};
+
+struct BrailleTable {
+  BrailleEntry entries[256];
+  constexpr const BrailleEntry& operator[](uint8_t c) const { return entries[c]; }
+};
+
+constexpr BrailleTable makeBrailleTable() {
+  BrailleTable t{};
+  for (int c = ' '; c <= '~'; c++) {
+    t.entries[c] = {1, BRAILLE_FLAG_UNMAPPED, {0, 0}};
+  }
+  t.entries[' '] = {1, 0, {0, 0}};
+
+  for (int i = 0; i < 26; i++) {
+    uint8_t aToJ = i < 10 ? BRAILLE_FLAG_A_TO_J : 0;
+    t.entries['a' + i] = {1, aToJ, {braillePatterns[i], 0}};
+    t.entries['A' + i] = {2, (uint8_t)(BRAILLE_FLAG_CAPITAL | aToJ),
+                          {BRAILLE_CAPITAL_SIGN, braillePatterns[i]}};
+  }
+
+  // Digits 1-9, 0 reuse letters a-j behind the number sign
+  for (int d = 0; d < 10; d++) {
+    t.entries['0' + d] = {2, BRAILLE_FLAG_DIGIT,
+                          {BRAILLE_NUMBER_SIGN, braillePatterns[d == 0 ? 9 : d - 1]}};
+  }
+
+  // Unified English Braille punctuation and common symbols
+  struct Symbol { char c; const char* first; const char* second; };
+  const Symbol symbols[] = {
+    {',', "2", nullptr},     {';', "23", nullptr},    {':', "25", nullptr},
+    {'.', "256", nullptr},   {'!', "235", nullptr},   {'?', "236", nullptr},
+    {'\'', "3", nullptr},    {'-', "36", nullptr},    {'"', "6", "2356"},
+    {'(', "5", "126"},       {')', "5", "345"},       {'/', "456", "34"},
+    {'@', "4", "1"},         {'&', "4", "12346"},     {'+', "5", "235"},
+    {'=', "5", "2356"},      {'*', "5", "35"},        {'#', "456", "1456"},
+    {'$', "4", "234"},       {'%', "46", "356"},      {'<', "4", "126"},
+    {'>', "4", "345"},       {'_', "46", "36"},
+  };
+  for (const Symbol& s : symbols) {
+    t.entries[(uint8_t)s.c] = {(uint8_t)(s.second ? 2 : 1), 0,
+                               {dots(s.first), s.second ? dots(s.second) : (uint8_t)0}};
+  }
+  return t;
+}
+
+constexpr BrailleTable BRAILLE_TABLE = makeBrailleTable();
+
+// Every mapped character must translate to a distinct cell sequence
+constexpr bool brailleEntriesCollide(const BrailleEntry& a, const BrailleEntry& b) {
+  if (a.len == 0 || b.len == 0 || (a.flags | b.flags) & BRAILLE_FLAG_UNMAPPED) {
+    return false;
+  }
+  return a.len == b.len && a.cells[0] == b.cells[0] && (a.len == 1 || a.cells[1] == b.cells[1]);
+}
+
+constexpr bool brailleTableUnique(const BrailleTable& t) {
+  for (int i = 0; i < 256; i++) {
+    for (int j = i + 1; j < 256; j++) {
+      if (brailleEntriesCollide(t.entries[i], t.entries[j])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(brailleTableUnique(BRAILLE_TABLE), "Two characters translate to the same braille cells");
+static_assert(BRAILLE_TABLE['a'].cells[0] == braillePatterns[0], "Table letters must come from braillePatterns");
+static_assert(BRAILLE_TABLE['1'].cells[1] == BRAILLE_TABLE['a'].cells[0], "Digit 1 must be written as a");
+
+// ===== Unicode Braille Patterns =====
+// U+2800..U+28FF carry dots 1-6 in bits 0-5 (dots 7-8 are dropped), i.e.
+// reversed relative to our cell encoding.
+constexpr uint8_t unicodeDotsToCell(uint8_t bits) {
+  uint8_t cell = 0;
+  for (int dot = 1; dot <= 6; dot++) {
+    if (bits & (1 << (dot - 1))) {
+      cell |= 1 << (6 - dot);
+    }
+  }
+  return cell;
+}
+
+static_assert(unicodeDotsToCell(0x01) == braillePatterns[0], "U+2801 is the letter a");
+
+// ===== Grade 1 Translation =====
+// Translates UTF-8 text into cells, handing each one to push(cell), which
+// returns false to stop (e.g. queue full). The number sign is emitted once
+// per run of digits, and a-j straight after a number get the letter sign.
+// Returns the number of input bytes consumed.
+template <typename Sink>
+size_t brailleTranslate(const uint8_t* text, size_t length, bool capitals, Sink&& push) {
+  bool inNumber = false;
+  size_t i = 0;
+  while (i < length) {
+    uint8_t c = text[i];
+
+    if (c >= 0x80) {
+      // U+28xx is E2 A0..A3 80..BF: show the pattern directly.
+      // Any other code point is shown blank. Only the continuation bytes
+      // actually there are skipped, so a truncated or stray lead byte
+      // costs one blank cell and never the characters after it.
+      size_t seqLen = (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : (c >= 0xC0) ? 2 : 1;
+      size_t end = i + 1;
+      while (end < length && end - i < seqLen && (text[end] & 0xC0) == 0x80) {
+        end++;
+      }
+      uint8_t cell = 0;
+      if (end - i == 3 && c == 0xE2 && (text[i + 1] & 0xFC) == 0xA0) {
+        cell = unicodeDotsToCell(text[i + 2] & 0x3F);
+      }
+      if (seqLen > 1 && !push(cell)) {
+        return i;
+      }
+      inNumber = false;
+      i = end;
+      continue;
+    }
+
+    const BrailleEntry& e = BRAILLE_TABLE[c];
+    if (e.len == 0) {
+      i++;
+      continue;
+    }
+
+    // Skip the indicator where it is redundant
+    uint8_t first = ((e.flags & BRAILLE_FLAG_CAPITAL) && !capitals) ||
+                    ((e.flags & BRAILLE_FLAG_DIGIT) && inNumber);
+    bool capitalShown = (e.flags & BRAILLE_FLAG_CAPITAL) && capitals;
+    if (inNumber && (e.flags & BRAILLE_FLAG_A_TO_J) && !capitalShown && !push(BRAILLE_LETTER_SIGN)) {
+      return i;
+    }
+    for (uint8_t k = first; k < e.len; k++) {
+      if (!push(e.cells[k])) {
+        return i;
+      }
+    }
+    inNumber = (e.flags & BRAILLE_FLAG_DIGIT) != 0;
+    i++;
+  }
+  return i;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Binary Cell Frame Protocol =====
+// Pre-translated cells published on mqtt_topic_cells. Multi-byte fields are
+// big-endian:
+//   0     version (CELL_FRAME_VERSION)
+//   1     flags (CELL_FRAME_FLAG_*)
+//   2-3   sequence number, +1 per frame, wraps at 65535
+//   4-5   dwell per cell in ms, 0 = device default
+//   6-7   cell count
+//   8-15  only with CELL_FRAME_FLAG_TIMED: when to show the first cell,
+//         in ms since the Unix epoch (UTC, see the SNTP clock in main.cpp)
+//   ..    cells, 6 bits each, packed MSB first (4 cells per 3 bytes)
+//
+// Frames are decoded in place from the MQTT receive buffer.
+const uint8_t CELL_FRAME_VERSION = 1;
+const size_t CELL_FRAME_HEADER_SIZE = 8;
+const size_t CELL_FRAME_TIME_SIZE = 8;
+
+const uint8_t CELL_FRAME_FLAG_SYNC = 0x01;   // Sender (re)started its sequence
+const uint8_t CELL_FRAME_FLAG_TIMED = 0x02;  // Carries a show-at time
+
+struct CellFrame {
+  uint8_t flags;
+  uint16_t sequence;
+  uint16_t dwellMs;
+  uint16_t cellCount;
+  uint64_t showAtMs;       // With CELL_FRAME_FLAG_TIMED, else 0
+  const uint8_t* packed;   // Points into the original payload
+};
+
+constexpr size_t cellFramePackedSize(uint16_t cellCount) {
+  return ((size_t)cellCount * 6 + 7) / 8;
+}
+
+inline uint16_t cellFrameRead16(const uint8_t* p) {
+  return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+// Validates the header and that the payload holds every announced cell
+inline bool parseCellFrame(const uint8_t* data, size_t length, CellFrame& frame) {
+  if (length < CELL_FRAME_HEADER_SIZE || data[0] != CELL_FRAME_VERSION) {
+    return false;
+  }
+  frame.flags = data[1];
+  frame.sequence = cellFrameRead16(data + 2);
+  frame.dwellMs = cellFrameRead16(data + 4);
+  frame.cellCount = cellFrameRead16(data + 6);
+  frame.showAtMs = 0;
+  size_t header = CELL_FRAME_HEADER_SIZE;
+  if (frame.flags & CELL_FRAME_FLAG_TIMED) {
+    if (length < header + CELL_FRAME_TIME_SIZE) {
+      return false;
+    }
+    for (size_t i = 0; i < CELL_FRAME_TIME_SIZE; i++) {
+      frame.showAtMs = frame.showAtMs << 8 | data[header + i];
+    }
+    header += CELL_FRAME_TIME_SIZE;
+  }
+  frame.packed = data + header;
+  return length - header >= cellFramePackedSize(frame.cellCount);
+}
+
+// Extracts cell i; a cell never spans more than two bytes
+inline uint8_t cellFrameCell(const CellFrame& frame, size_t i) {
+  size_t bit = i * 6;
+  size_t byte = bit >> 3;
+  unsigned shift = bit & 7;
+  uint16_t window = frame.packed[byte] << 8;
+  if (shift > 2) {
+    window |= frame.packed[byte + 1];
+  }
+  return (window >> (10 - shift)) & 0x3F;
+}
+
+// ===== Frame Sequence Tracking =====
+// Serial-number arithmetic on the 16-bit sequence: anything at or behind
+// the last accepted frame is a duplicate (e.g. a QoS 1 redelivery), a jump
+// of more than one means frames were lost.
+class FrameSequence {
+ public:
+  // Returns false if the frame should be dropped; missed is set to the
+  // number of frames skipped since the last accepted one.
+  bool accept(uint16_t sequence, bool sync, uint16_t& missed) {
+    missed = 0;
+    if (!started_ || sync) {
+      started_ = true;
+      last_ = sequence;
+      return true;
+    }
+    int16_t delta = (int16_t)(sequence - last_);
+    if (delta <= 0) {
+      return false;
+    }
+    missed = delta - 1;
+    last_ = sequence;
+    return true;
+  }
+
+  // For carrying the position across a reset
+  bool started() const { return started_; }
+  uint16_t last() const { return last_; }
+  void restore(uint16_t last) {
+    started_ = true;
+    last_ = last;
+  }
+
+ private:
+  bool started_ = false;
+  uint16_t last_ = 0;
+};
+
+// ===== Display Acknowledgment =====
+// Published by the device once the last cell of a frame has been sent to
+// the servos, so senders can keep a window of frames in flight instead of
+// waiting for each one. Acks are cumulative: sequence N means every frame
+// up to N has been shown. With CELL_ACK_FLAG_DROPPED the ack only refers
+// to frame N, which did not fit in the cell queue (fully or in part).
+//   0     version (CELL_FRAME_VERSION)
+//   1     flags (CELL_ACK_FLAG_*), bits 1-2: scope (CELL_ACK_SCOPE_*)
+//   2-3   sequence number of the frame
+//   4-5   free cells in the device queue
+const size_t CELL_ACK_SIZE = 6;
+
+const uint8_t CELL_ACK_FLAG_DROPPED = 0x01;
+
+// Which topic the frame arrived on; each scope has its own sequence
+const uint8_t CELL_ACK_SCOPE_SHIFT = 1;
+const uint8_t CELL_ACK_SCOPE_BROADCAST = 0;   // braille/cells
+const uint8_t CELL_ACK_SCOPE_GROUP = 1;       // braille/group/<group>/cells
+const uint8_t CELL_ACK_SCOPE_DEVICE = 2;      // braille/<device id>/cells
+
+inline size_t encodeCellAck(uint16_t sequence, uint8_t flags, uint16_t queueFree, uint8_t out[CELL_ACK_SIZE]) {
+  out[0] = CELL_FRAME_VERSION;
+  out[1] = flags;
+  out[2] = sequence >> 8;
+  out[3] = sequence;
+  out[4] = queueFree >> 8;
+  out[5] = queueFree;
+  return CELL_ACK_SIZE;
+}
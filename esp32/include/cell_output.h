@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Display Output Drivers =====
+// The display is a line of DISPLAY_CELLS six-dot cells. Drivers take pulse
+// widths per dot; which driver is built is chosen with build flags.
+#define DISPLAY_DRIVER_SERVO_PINS 0   // One cell, six servos on GPIO (LEDC)
+#define DISPLAY_DRIVER_PCA9685    1   // Up to 2 cells per PCA9685 I2C PWM board
+#define DISPLAY_DRIVER_HOST       2   // Native env: records pulses in RAM (host_output.h)
+
+#ifndef DISPLAY_DRIVER
+#define DISPLAY_DRIVER DISPLAY_DRIVER_SERVO_PINS
+#endif
+
+#ifndef DISPLAY_CELLS
+#define DISPLAY_CELLS 1
+#endif
+
+#if DISPLAY_DRIVER == DISPLAY_DRIVER_SERVO_PINS && DISPLAY_CELLS != 1
+#error "The servo pin driver can only drive a single cell"
+#endif
+
+class CellOutput {
+ public:
+  virtual ~CellOutput() = default;
+
+  virtual void begin() = 0;
+
+  // Stages new pulse widths for the dots of `cell` selected by `mask`
+  // (bit i = dot index i); unselected dots keep their current output.
+  virtual void writeCell(size_t cell, const uint16_t pulseUs[6], uint8_t mask) = 0;
+
+  // Sends everything staged since the last flush.
+  virtual void flush() = 0;
+
+  // Stops the pulses to every servo; they hold their position by gear
+  // friction and stop humming. The next flush() drives them all again.
+  virtual void release() = 0;
+};
+
+// The driver selected by DISPLAY_DRIVER
+CellOutput& displayOutput();
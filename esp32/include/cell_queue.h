@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// ===== Queued Cell =====
+struct QueuedCell {
+  uint8_t pattern;    // 6-bit cell, see braille_table.h
+  uint16_t dwellMs;   // How long to hold it, 0 = CELL_DWELL_MS
+  uint32_t receivedUs;  // latencyNow() when its message arrived (latency.h)
+  uint16_t ackSequence; // Frame to acknowledge once shown, if QUEUED_CELL_ACK
+  uint8_t flags;
+  uint32_t showAtMs;    // millis() to show it at, if QUEUED_CELL_TIMED
+};
+
+enum QueuedCellFlags : uint8_t {
+  QUEUED_CELL_ACK = 1 << 0,   // Last cell of a binary frame (cell_frame.h)
+  QUEUED_CELL_TIMED = 1 << 3, // First cell of a timed frame; starts a line
+  QUEUED_CELL_BREAK = 1 << 4, // Starts a line, e.g. a quiz prompt
+};
+
+const uint8_t QUEUED_CELL_SCOPE_SHIFT = 1;   // Bits 1-2: CELL_ACK_SCOPE_* of the frame
+
+// ===== Braille Cell Queue =====
+// Fixed-size ring buffer of cells waiting to be shown.
+// The MQTT callback pushes a whole word/sentence at once and the playback
+// stage pops one cell per dwell period.
+//
+// Lock-free for exactly one producer (the network task) and one consumer
+// (the actuation task): only push() writes head_ and only pop()/clear()
+// write tail_. head_ and tail_ are free-running counters; Capacity must be
+// a power of two so they can be wrapped with a mask and still tell "full"
+// from "empty".
+template <size_t Capacity>
+class CellQueue {
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "CellQueue capacity must be a power of two");
+
+ public:
+  // Producer side.
+  bool push(const QueuedCell& cell) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+      return false;
+    }
+    cells_[head & (Capacity - 1)] = cell;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(QueuedCell& cell) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) == tail) {
+      return false;
+    }
+    cell = cells_[tail & (Capacity - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: reads the cell `offset` places from the front without
+  // removing it.
+  bool peek(size_t offset, QueuedCell& cell) const {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (head_.load(std::memory_order_acquire) - tail <= offset) {
+      return false;
+    }
+    cell = cells_[(tail + offset) & (Capacity - 1)];
+    return true;
+  }
+
+  // Consumer side: drops everything queued so far.
+  void clear() {
+    tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+  // Snapshots; exact only when called from the producer or consumer.
+  bool empty() const { return size() == 0; }
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  size_t available() const { return Capacity - size(); }
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  QueuedCell cells_[Capacity] = {};
+  std::atomic<size_t> head_{0};  // next slot to write
+  std::atomic<size_t> tail_{0};  // next slot to read
+};
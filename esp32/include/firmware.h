@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// ===== Firmware Entry Points =====
+// For test builds (pio test, PIO_UNIT_TESTING), which bring their own
+// setup()/loop(). The device build's setup() is firmwareSetup(true).
+
+// Boot: logging, RTC mirrors, topics, MQTT client and the actuation task;
+// the network task only if `startNetwork`. Without it, messages are fed
+// straight into mqttCallback() by the caller, which then is the only
+// producer of the cell queue.
+void firmwareSetup(bool startNetwork);
+
+// The MQTT message handler, topic routing and all (main.cpp)
+void mqttCallback(char* topic, uint8_t* payload, unsigned int length);
+
+// Free cell queue slots; exact when called by the producer
+size_t firmwareQueueAvailable();
+
+// Longest actuation task iteration in µs; telemetry exchanges it with 0
+extern std::atomic<uint32_t> actuationLoopMaxUs;
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "braille_table.h"
+
+// ===== Grade 2 (Contracted) Braille =====
+// Unified English Braille contractions, wordsigns and common shortforms.
+// The table and its lookup index are built at compile time and live in
+// flash; translation works straight off the payload with no heap and a
+// bounded amount of work per input byte (one bucket scan per position).
+enum Grade2Rule : uint8_t {
+  G2_ANY,        // Anywhere in a word
+  G2_WORD,       // Only as a whole word
+  G2_START,      // At the start of a longer word (be-, con-, dis-)
+  G2_MIDDLE,     // Neither first nor last letter of the word (ea, bb, ...)
+  G2_NOT_START,  // Anywhere except the start of a word (-ing, -tion, ...)
+};
+
+const uint8_t G2_MAX_CELLS = 3;
+const uint8_t G2_MAX_LEN = 12;
+
+struct Contraction {
+  const char* text;   // Lower-case letters only
+  uint8_t len;
+  uint8_t rule;
+  uint8_t cellCount;
+  uint8_t cells[G2_MAX_CELLS];
+};
+
+constexpr uint8_t grade2StrLen(const char* s) {
+  uint8_t n = 0;
+  while (s[n]) {
+    n++;
+  }
+  return n;
+}
+
+// Cells are given as dot numbers, e.g. contraction("day", G2_ANY, "5", "145")
+constexpr Contraction contraction(const char* text, Grade2Rule rule, const char* c1,
+                                  const char* c2 = nullptr, const char* c3 = nullptr) {
+  return {text, grade2StrLen(text), rule, (uint8_t)(c3 ? 3 : c2 ? 2 : 1),
+          {dots(c1), c2 ? dots(c2) : (uint8_t)0, c3 ? dots(c3) : (uint8_t)0}};
+}
+
+constexpr Contraction G2_CONTRACTIONS[] = {
+  // Alphabetic wordsigns
+  contraction("but", G2_WORD, "12"),          contraction("can", G2_WORD, "14"),
+  contraction("do", G2_WORD, "145"),          contraction("every", G2_WORD, "15"),
+  contraction("from", G2_WORD, "124"),        contraction("go", G2_WORD, "1245"),
+  contraction("have", G2_WORD, "125"),        contraction("just", G2_WORD, "245"),
+  contraction("knowledge", G2_WORD, "13"),    contraction("like", G2_WORD, "123"),
+  contraction("more", G2_WORD, "134"),        contraction("not", G2_WORD, "1345"),
+  contraction("people", G2_WORD, "1234"),     contraction("quite", G2_WORD, "12345"),
+  contraction("rather", G2_WORD, "1235"),     contraction("so", G2_WORD, "234"),
+  contraction("that", G2_WORD, "2345"),       contraction("us", G2_WORD, "136"),
+  contraction("very", G2_WORD, "1236"),       contraction("will", G2_WORD, "2456"),
+  contraction("it", G2_WORD, "1346"),         contraction("you", G2_WORD, "13456"),
+  contraction("as", G2_WORD, "1356"),
+
+  // Strong contractions
+  contraction("and", G2_ANY, "12346"),        contraction("for", G2_ANY, "123456"),
+  contraction("of", G2_ANY, "12356"),         contraction("the", G2_ANY, "2346"),
+  contraction("with", G2_ANY, "23456"),
+
+  // Strong wordsigns
+  contraction("child", G2_WORD, "16"),        contraction("shall", G2_WORD, "146"),
+  contraction("this", G2_WORD, "1456"),       contraction("which", G2_WORD, "156"),
+  contraction("out", G2_WORD, "1256"),        contraction("still", G2_WORD, "34"),
+
+  // Strong groupsigns
+  contraction("ch", G2_ANY, "16"),            contraction("gh", G2_ANY, "126"),
+  contraction("sh", G2_ANY, "146"),           contraction("th", G2_ANY, "1456"),
+  contraction("wh", G2_ANY, "156"),           contraction("ed", G2_ANY, "1246"),
+  contraction("er", G2_ANY, "12456"),         contraction("ou", G2_ANY, "1256"),
+  contraction("ow", G2_ANY, "246"),           contraction("st", G2_ANY, "34"),
+  contraction("ar", G2_ANY, "345"),           contraction("ing", G2_NOT_START, "346"),
+
+  // Lower wordsigns and groupsigns
+  contraction("be", G2_WORD, "23"),           contraction("enough", G2_WORD, "26"),
+  contraction("were", G2_WORD, "2356"),       contraction("his", G2_WORD, "236"),
+  contraction("in", G2_WORD, "35"),           contraction("was", G2_WORD, "356"),
+  contraction("en", G2_ANY, "26"),            contraction("in", G2_ANY, "35"),
+  contraction("be", G2_START, "23"),          contraction("con", G2_START, "25"),
+  contraction("dis", G2_START, "256"),        contraction("ea", G2_MIDDLE, "2"),
+  contraction("bb", G2_MIDDLE, "23"),         contraction("cc", G2_MIDDLE, "25"),
+  contraction("ff", G2_MIDDLE, "235"),        contraction("gg", G2_MIDDLE, "2356"),
+
+  // Initial-letter contractions
+  contraction("day", G2_ANY, "5", "145"),       contraction("ever", G2_ANY, "5", "15"),
+  contraction("father", G2_ANY, "5", "124"),    contraction("here", G2_ANY, "5", "125"),
+  contraction("know", G2_ANY, "5", "13"),       contraction("lord", G2_ANY, "5", "123"),
+  contraction("mother", G2_ANY, "5", "134"),    contraction("name", G2_ANY, "5", "1345"),
+  contraction("one", G2_ANY, "5", "135"),       contraction("part", G2_ANY, "5", "1234"),
+  contraction("question", G2_ANY, "5", "12345"), contraction("right", G2_ANY, "5", "1235"),
+  contraction("some", G2_ANY, "5", "234"),      contraction("time", G2_ANY, "5", "2345"),
+  contraction("under", G2_ANY, "5", "136"),     contraction("work", G2_ANY, "5", "2456"),
+  contraction("young", G2_ANY, "5", "13456"),   contraction("there", G2_ANY, "5", "2346"),
+  contraction("character", G2_ANY, "5", "16"),  contraction("through", G2_ANY, "5", "1456"),
+  contraction("where", G2_ANY, "5", "156"),     contraction("ought", G2_ANY, "5", "1256"),
+  contraction("upon", G2_ANY, "45", "136"),     contraction("word", G2_ANY, "45", "2456"),
+  contraction("these", G2_ANY, "45", "2346"),   contraction("those", G2_ANY, "45", "1456"),
+  contraction("whose", G2_ANY, "45", "156"),    contraction("cannot", G2_ANY, "456", "14"),
+  contraction("had", G2_ANY, "456", "125"),     contraction("many", G2_ANY, "456", "134"),
+  contraction("spirit", G2_ANY, "456", "234"),  contraction("world", G2_ANY, "456", "2456"),
+  contraction("their", G2_ANY, "456", "2346"),
+
+  // Final-letter groupsigns
+  contraction("ound", G2_NOT_START, "46", "145"),  contraction("ance", G2_NOT_START, "46", "15"),
+  contraction("sion", G2_NOT_START, "46", "1345"), contraction("less", G2_NOT_START, "46", "234"),
+  contraction("ount", G2_NOT_START, "46", "2345"), contraction("ence", G2_NOT_START, "56", "15"),
+  contraction("ong", G2_NOT_START, "56", "1245"),  contraction("ful", G2_NOT_START, "56", "123"),
+  contraction("tion", G2_NOT_START, "56", "1345"), contraction("ness", G2_NOT_START, "56", "234"),
+  contraction("ment", G2_NOT_START, "56", "2345"), contraction("ity", G2_NOT_START, "56", "13456"),
+
+  // Shortforms
+  contraction("about", G2_WORD, "1", "12"),           contraction("above", G2_WORD, "1", "12", "1236"),
+  contraction("according", G2_WORD, "1", "14"),       contraction("after", G2_WORD, "1", "124"),
+  contraction("again", G2_WORD, "1", "1245"),         contraction("also", G2_WORD, "1", "123"),
+  contraction("always", G2_WORD, "1", "123", "2456"), contraction("because", G2_WORD, "23", "14"),
+  contraction("before", G2_WORD, "23", "124"),        contraction("behind", G2_WORD, "23", "125"),
+  contraction("below", G2_WORD, "23", "123"),         contraction("beside", G2_WORD, "23", "234"),
+  contraction("between", G2_WORD, "23", "2345"),      contraction("beyond", G2_WORD, "23", "13456"),
+  contraction("braille", G2_WORD, "12", "1235", "123"), contraction("children", G2_WORD, "16", "1345"),
+  contraction("could", G2_WORD, "14", "145"),         contraction("first", G2_WORD, "124", "34"),
+  contraction("friend", G2_WORD, "124", "1235"),      contraction("good", G2_WORD, "1245", "145"),
+  contraction("great", G2_WORD, "1245", "1235", "2345"), contraction("its", G2_WORD, "1346", "234"),
+  contraction("letter", G2_WORD, "123", "1235"),      contraction("little", G2_WORD, "123", "123"),
+  contraction("much", G2_WORD, "134", "16"),          contraction("must", G2_WORD, "134", "34"),
+  contraction("necessary", G2_WORD, "1345", "15", "14"), contraction("quick", G2_WORD, "12345", "13"),
+  contraction("said", G2_WORD, "234", "145"),         contraction("should", G2_WORD, "146", "145"),
+  contraction("such", G2_WORD, "234", "16"),          contraction("today", G2_WORD, "2345", "145"),
+  contraction("together", G2_WORD, "2345", "1245", "1235"), contraction("would", G2_WORD, "2456", "145"),
+  contraction("your", G2_WORD, "13456", "1235"),
+};
+
+constexpr size_t G2_CONTRACTION_COUNT = sizeof(G2_CONTRACTIONS) / sizeof(G2_CONTRACTIONS[0]);
+static_assert(G2_CONTRACTION_COUNT < 256, "Grade2Index stores uint8_t positions");
+
+// ===== Grade 2 Lookup Index =====
+// Contractions bucketed by first letter; each bucket is ordered longest
+// first, so the first entry whose rule fits is the longest match.
+struct Grade2Index {
+  uint8_t order[G2_CONTRACTION_COUNT];
+  uint8_t bucketStart[27];
+};
+
+constexpr Grade2Index makeGrade2Index() {
+  Grade2Index index{};
+  uint8_t counts[26] = {};
+  for (size_t i = 0; i < G2_CONTRACTION_COUNT; i++) {
+    counts[G2_CONTRACTIONS[i].text[0] - 'a']++;
+  }
+  for (int b = 0; b < 26; b++) {
+    index.bucketStart[b + 1] = index.bucketStart[b] + counts[b];
+  }
+  uint8_t fill[26] = {};
+  for (size_t i = 0; i < G2_CONTRACTION_COUNT; i++) {
+    int b = G2_CONTRACTIONS[i].text[0] - 'a';
+    // Insertion sort within the bucket, longest first
+    size_t pos = index.bucketStart[b] + fill[b]++;
+    while (pos > index.bucketStart[b] && G2_CONTRACTIONS[index.order[pos - 1]].len < G2_CONTRACTIONS[i].len) {
+      index.order[pos] = index.order[pos - 1];
+      pos--;
+    }
+    index.order[pos] = (uint8_t)i;
+  }
+  return index;
+}
+
+constexpr Grade2Index G2_INDEX = makeGrade2Index();
+
+constexpr bool grade2TableValid() {
+  for (size_t i = 0; i < G2_CONTRACTION_COUNT; i++) {
+    const Contraction& c = G2_CONTRACTIONS[i];
+    if (c.len < 2 || c.len > G2_MAX_LEN) {
+      return false;
+    }
+    for (uint8_t k = 0; k < c.len; k++) {
+      if (c.text[k] < 'a' || c.text[k] > 'z') {
+        return false;
+      }
+    }
+    // Same text may appear under different rules, but never twice with one rule
+    for (size_t j = i + 1; j < G2_CONTRACTION_COUNT; j++) {
+      const Contraction& d = G2_CONTRACTIONS[j];
+      bool sameText = c.len == d.len;
+      for (uint8_t k = 0; sameText && k < c.len; k++) {
+        sameText = c.text[k] == d.text[k];
+      }
+      if (sameText && c.rule == d.rule) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(grade2TableValid(), "Grade 2 contractions must be unique lower-case words of 2-12 letters");
+static_assert(G2_INDEX.bucketStart[26] == G2_CONTRACTION_COUNT, "Every contraction must be indexed");
+
+// ===== Grade 2 Translation =====
+constexpr bool grade2IsLetter(uint8_t c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr uint8_t grade2Lower(uint8_t c) {
+  return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
+
+// Longest contraction at text[pos] allowed by its rule within [wordStart, wordEnd)
+inline const Contraction* grade2Match(const uint8_t* text, size_t wordStart, size_t pos, size_t wordEnd) {
+  int bucket = grade2Lower(text[pos]) - 'a';
+  for (uint8_t k = G2_INDEX.bucketStart[bucket]; k < G2_INDEX.bucketStart[bucket + 1]; k++) {
+    const Contraction& c = G2_CONTRACTIONS[G2_INDEX.order[k]];
+    if (pos + c.len > wordEnd) {
+      continue;
+    }
+    bool matches = true;
+    for (uint8_t i = 1; matches && i < c.len; i++) {
+      matches = grade2Lower(text[pos + i]) == (uint8_t)c.text[i];
+    }
+    if (!matches) {
+      continue;
+    }
+    bool atStart = pos == wordStart;
+    bool atEnd = pos + c.len == wordEnd;
+    switch (c.rule) {
+      case G2_ANY:       return &c;
+      case G2_WORD:      if (atStart && atEnd) return &c; break;
+      case G2_START:     if (atStart && !atEnd) return &c; break;
+      case G2_MIDDLE:    if (!atStart && !atEnd) return &c; break;
+      case G2_NOT_START: if (!atStart) return &c; break;
+    }
+  }
+  return nullptr;
+}
+
+constexpr bool grade2ReadsAsDigit(uint8_t cell) {
+  for (int i = 0; i < 10; i++) {
+    if (braillePatterns[i] == cell) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Emits one word (letters only). A lone letter other than a/i/o, or a word
+// that would read as digits after a number, gets the letter sign; with
+// capitals enabled a capitalised word gets the capital sign, an upper-case
+// word the double capital sign.
+template <typename Sink>
+bool grade2Word(const uint8_t* text, size_t start, size_t end, bool capitals, bool afterDigit, Sink&& push) {
+  bool upperStart = text[start] <= 'Z';
+  bool allUpper = end - start > 1;
+  for (size_t i = start; allUpper && i < end; i++) {
+    allUpper = text[i] <= 'Z';
+  }
+
+  bool first = true;
+  size_t pos = start;
+  while (pos < end) {
+    const Contraction* c = grade2Match(text, start, pos, end);
+    uint8_t single = braillePatterns[grade2Lower(text[pos]) - 'a'];
+    const uint8_t* cells = c ? c->cells : &single;
+    uint8_t count = c ? c->cellCount : 1;
+
+    if (first) {
+      uint8_t lower = grade2Lower(text[start]);
+      bool showCapital = capitals && upperStart;
+      bool loneWordsign = end - start == 1 && lower != 'a' && lower != 'i' && lower != 'o';
+      if ((loneWordsign || (afterDigit && !showCapital && grade2ReadsAsDigit(cells[0]))) &&
+          !push(BRAILLE_LETTER_SIGN)) {
+        return false;
+      }
+      if (showCapital && !push(BRAILLE_CAPITAL_SIGN)) {
+        return false;
+      }
+      if (showCapital && allUpper && !push(BRAILLE_CAPITAL_SIGN)) {
+        return false;
+      }
+      first = false;
+    }
+
+    for (uint8_t k = 0; k < count; k++) {
+      if (!push(cells[k])) {
+        return false;
+      }
+    }
+    pos += c ? c->len : 1;
+  }
+  return true;
+}
+
+// Same contract as brailleTranslate(): words are contracted, everything
+// between words goes through the grade 1 table. Returns bytes consumed
+// (a partially emitted word counts as not consumed).
+template <typename Sink>
+size_t grade2Translate(const uint8_t* text, size_t length, bool capitals, Sink&& push) {
+  bool afterDigit = false;
+  size_t i = 0;
+  while (i < length) {
+    size_t end = i;
+    if (!grade2IsLetter(text[i])) {
+      while (end < length && !grade2IsLetter(text[end])) {
+        end++;
+      }
+      size_t used = brailleTranslate(text + i, end - i, capitals, push);
+      if (used < end - i) {
+        return i + used;
+      }
+      afterDigit = text[end - 1] >= '0' && text[end - 1] <= '9';
+    } else {
+      while (end < length && grade2IsLetter(text[end])) {
+        end++;
+      }
+      if (!grade2Word(text, i, end, capitals, afterDigit, push)) {
+        return i;
+      }
+      afterDigit = false;
+    }
+    i = end;
+  }
+  return i;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// ===== Heap Guard =====
+// Debug check that the message path stays allocation-free. Builds with
+// HEAP_GUARD=1 link malloc/calloc/realloc through wrappers (see the debug
+// env in platformio.ini); while a HeapGuard is alive, any allocation made
+// by the same task fails an assert, so the panic backtrace names the
+// caller. HeapGuardPause exempts calls that allocate by design, such as
+// lwIP buffers for a publish. Without HEAP_GUARD both compile to nothing.
+#ifndef HEAP_GUARD
+#define HEAP_GUARD 0
+#endif
+
+#if HEAP_GUARD
+
+#include <Arduino.h>
+
+class HeapGuard {
+ public:
+  HeapGuard() : previous_(guardedTask) { guardedTask = xTaskGetCurrentTaskHandle(); }
+  ~HeapGuard() { guardedTask = previous_; }
+  HeapGuard(const HeapGuard&) = delete;
+  HeapGuard& operator=(const HeapGuard&) = delete;
+
+  static TaskHandle_t guardedTask;   // Task whose allocations are refused
+
+ private:
+  TaskHandle_t previous_;
+};
+
+class HeapGuardPause {
+ public:
+  HeapGuardPause() : previous_(HeapGuard::guardedTask) { HeapGuard::guardedTask = nullptr; }
+  ~HeapGuardPause() { HeapGuard::guardedTask = previous_; }
+  HeapGuardPause(const HeapGuardPause&) = delete;
+  HeapGuardPause& operator=(const HeapGuardPause&) = delete;
+
+ private:
+  TaskHandle_t previous_;
+};
+
+#else
+
+// User-provided destructors keep `HeapGuard guard;` free of unused warnings
+struct HeapGuard {
+  ~HeapGuard() {}
+};
+struct HeapGuardPause {
+  ~HeapGuardPause() {}
+};
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_output.h"
+
+// ===== Host Output Driver =====
+// DISPLAY_DRIVER_HOST: no hardware, the native env's stand-in for the
+// servo drivers. Keeps the last pulse width of every dot and counts
+// driver calls so tests and benchmarks can check what was commanded.
+class HostOutput : public CellOutput {
+ public:
+  void begin() override {}
+
+  void writeCell(size_t cell, const uint16_t pulseUs[6], uint8_t mask) override {
+    for (int i = 0; i < 6; i++) {
+      if ((mask >> i) & 1) {
+        staged[cell][i] = pulseUs[i];
+        dotWrites++;
+      }
+    }
+  }
+
+  void flush() override {
+    for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+      for (int i = 0; i < 6; i++) {
+        pulseUs[c][i] = staged[c][i];
+      }
+    }
+    flushes++;
+    released = false;
+  }
+
+  void release() override { released = true; }
+
+  uint16_t pulseUs[DISPLAY_CELLS][6] = {};   // Output since the last flush()
+  uint16_t staged[DISPLAY_CELLS][6] = {};
+  uint32_t dotWrites = 0;
+  uint32_t flushes = 0;
+  bool released = false;
+};
+
+// The instance displayOutput() returns in the native env
+HostOutput& hostOutput();
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp_timer.h>
+
+// ===== Latency Instrumentation =====
+// Every message is stamped with esp_timer_get_time() when mqttCallback is
+// entered; the stamp travels with its cells through cellQueue so the
+// actuation task can measure receipt -> servo command. Each stage keeps a
+// fixed histogram in RAM with power-of-two buckets: bucket k counts
+// durations in [2^k, 2^(k+1)) µs, the last bucket everything longer.
+//
+// Each stage is recorded by exactly one task (decode/enqueue: network,
+// command/total: actuation), so recording takes no lock.
+enum LatencyStage : uint8_t {
+  LATENCY_DECODE,     // Callback entry -> first cell queued
+  LATENCY_ENQUEUE,    // Callback entry -> whole message queued
+  LATENCY_COMMAND,    // Driver writes + flush for one line
+  LATENCY_TOTAL,      // Callback entry -> servo command, per cell
+  LATENCY_STAGE_COUNT
+};
+
+const size_t LATENCY_BUCKETS = 25;   // Up to ~16.8 s, the last bucket is open-ended
+
+// Low 32 bits of the µs clock; differences stay correct across the
+// 71-minute wrap.
+inline uint32_t latencyNow() {
+  return (uint32_t)esp_timer_get_time();
+}
+
+// Adds now - startUs to the stage's histogram.
+void latencyRecord(LatencyStage stage, uint32_t startUs);
+
+// Clears every histogram. The owning task applies it on its next record.
+void latencyReset();
+
+struct LatencySummary {
+  uint32_t count;
+  uint32_t meanUs;
+  uint32_t p50Us;     // Upper bucket edges, so within 2x
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+// Count, mean, p50/p99 bucket edges and max of one stage
+LatencySummary latencySummary(LatencyStage stage);
+
+// One summary line per stage (see latencySummary)
+void latencyLogReport();
+
+// Full histograms as JSON; returns the length written (0 if it didn't fit)
+size_t latencyFormatJson(char* out, size_t size);
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_frame.h"
+
+// ===== Lesson Bundles =====
+// A whole lesson in one MQTT message on <scope>/lesson, cached in flash
+// (lesson_cache.h) and played from there on <scope>/play, so repeating a
+// lesson only costs the play command. Multi-byte fields are big-endian:
+//   0      version (LESSON_VERSION)
+//   1      flags, reserved (0)
+//   2-5    lesson id
+//   6-9    version hash: FNV-1a over the steps (bytes 12..)
+//   10-11  step count
+//   12..   steps, each:
+//            0-1  dwell per cell in ms, 0 = device default
+//            2-3  cell count
+//            4..  cells packed as in cell_frame.h
+const uint8_t LESSON_VERSION = 1;
+const size_t LESSON_HEADER_SIZE = 12;
+const size_t LESSON_STEP_HEADER_SIZE = 4;
+
+struct LessonBundle {
+  uint32_t id;
+  uint32_t hash;
+  uint16_t stepCount;
+  const uint8_t* steps;    // Points into the payload or the flash mapping
+  size_t stepsLength;
+};
+
+inline uint32_t lessonRead32(const uint8_t* p) {
+  return (uint32_t)cellFrameRead16(p) << 16 | cellFrameRead16(p + 2);
+}
+
+inline uint32_t lessonHash(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// Reads the step at `offset` into `step` (a CellFrame without sequence)
+// and advances `offset` past it; false at the end or if it is truncated.
+inline bool lessonNextStep(const LessonBundle& lesson, size_t& offset, CellFrame& step) {
+  if (offset > lesson.stepsLength || lesson.stepsLength - offset < LESSON_STEP_HEADER_SIZE) {
+    return false;
+  }
+  const uint8_t* p = lesson.steps + offset;
+  step.flags = 0;
+  step.sequence = 0;
+  step.showAtMs = 0;
+  step.dwellMs = cellFrameRead16(p);
+  step.cellCount = cellFrameRead16(p + 2);
+  step.packed = p + LESSON_STEP_HEADER_SIZE;
+  size_t size = LESSON_STEP_HEADER_SIZE + cellFramePackedSize(step.cellCount);
+  if (lesson.stepsLength - offset < size) {
+    return false;
+  }
+  offset += size;
+  return true;
+}
+
+// Validates the header, that every step is complete and the version hash
+inline bool parseLessonBundle(const uint8_t* data, size_t length, LessonBundle& lesson) {
+  if (length < LESSON_HEADER_SIZE || data[0] != LESSON_VERSION) {
+    return false;
+  }
+  lesson.id = lessonRead32(data + 2);
+  lesson.hash = lessonRead32(data + 6);
+  lesson.stepCount = cellFrameRead16(data + 10);
+  lesson.steps = data + LESSON_HEADER_SIZE;
+  lesson.stepsLength = length - LESSON_HEADER_SIZE;
+
+  size_t offset = 0;
+  CellFrame step;
+  for (uint16_t i = 0; i < lesson.stepCount; i++) {
+    if (!lessonNextStep(lesson, offset, step)) {
+      return false;
+    }
+  }
+  return offset == lesson.stepsLength && lessonHash(lesson.steps, lesson.stepsLength) == lesson.hash;
+}
+
+// ===== Lesson Play Command =====
+// On <scope>/play; answered with a status (below) on
+// <mqtt_topic_lesson_status>/<device id>:
+//   0      version (LESSON_VERSION)
+//   1      flags, reserved (0)
+//   2-5    lesson id
+//   6-9    version hash
+//   10-11  first step
+//   12-13  number of steps, LESSON_PLAY_ALL = to the end
+const size_t LESSON_PLAY_SIZE = 14;
+const uint16_t LESSON_PLAY_ALL = 0xFFFF;
+
+struct LessonPlay {
+  uint32_t id;
+  uint32_t hash;
+  uint16_t firstStep;
+  uint16_t stepCount;
+};
+
+inline bool parseLessonPlay(const uint8_t* data, size_t length, LessonPlay& play) {
+  if (length < LESSON_PLAY_SIZE || data[0] != LESSON_VERSION) {
+    return false;
+  }
+  play.id = lessonRead32(data + 2);
+  play.hash = lessonRead32(data + 6);
+  play.firstStep = cellFrameRead16(data + 10);
+  play.stepCount = cellFrameRead16(data + 12);
+  return true;
+}
+
+// ===== Lesson Status =====
+//   0      version (LESSON_VERSION)
+//   1      status (LESSON_STATUS_*)
+//   2-5    lesson id
+//   6-9    version hash
+const size_t LESSON_STATUS_SIZE = 10;
+
+enum LessonStatus : uint8_t {
+  LESSON_STATUS_STORED,    // Bundle cached
+  LESSON_STATUS_PLAYING,   // Play command accepted
+  LESSON_STATUS_MISS,      // Not cached (or another version); send the bundle, the play resumes by itself
+  LESSON_STATUS_INVALID,   // Malformed bundle or command, or too large to cache
+};
+
+inline size_t encodeLessonStatus(LessonStatus status, uint32_t id, uint32_t hash, uint8_t out[LESSON_STATUS_SIZE]) {
+  out[0] = LESSON_VERSION;
+  out[1] = status;
+  for (int i = 0; i < 4; i++) {
+    out[2 + i] = id >> (24 - 8 * i);
+    out[6 + i] = hash >> (24 - 8 * i);
+  }
+  return LESSON_STATUS_SIZE;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lesson.h"
+
+// ===== Lesson Cache =====
+// Lesson bundles (lesson.h) in the "lessons" data partition
+// (partitions.csv), one 4 KB flash sector per lesson, keyed by id and
+// version hash. A stored lesson replaces an older version of the same id,
+// else takes a free sector, else the least recently stored one.
+//
+// Playback reads straight from flash: lessonCacheOpen() maps the sector
+// with esp_partition_mmap and points the LessonBundle into the mapping.
+// One lesson is mapped at a time. Network task only.
+const size_t LESSON_SLOT_SIZE = 4096;          // One erase sector
+const size_t LESSON_SLOT_HEADER_SIZE = 32;
+const size_t LESSON_MAX_SIZE = LESSON_SLOT_SIZE - LESSON_SLOT_HEADER_SIZE;
+const size_t LESSON_SLOTS_MAX = 64;            // Indexed in RAM
+
+// Finds the partition and indexes the cached lessons; false without one
+bool lessonCacheBegin();
+
+// Writes a bundle that parseLessonBundle() accepted. Closes the open
+// lesson first if it is stored in the sector being replaced.
+bool lessonCacheStore(const LessonBundle& lesson, const uint8_t* bundle, size_t length);
+
+bool lessonCacheContains(uint32_t id, uint32_t hash);
+
+// Maps a cached lesson; `lesson` stays valid until lessonCacheClose()
+// or the next open.
+bool lessonCacheOpen(uint32_t id, uint32_t hash, LessonBundle& lesson);
+void lessonCacheClose();
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_output.h"
+
+// ===== Line Display =====
+// What the servos show, on top of a CellOutput driver. Only dots whose bit
+// changes are commanded. Each moving dot gets a settle deadline; a line
+// counts as shown once its last moving dot has settled.
+//
+// Takes the time from the caller (millis() on the device) and touches no
+// Arduino API, so it also builds for the native env.
+#ifndef SERVO_SETTLE_MS
+#define SERVO_SETTLE_MS 200UL   // Full 0°-90° travel plus margin
+#endif
+
+// ===== Inrush Budget =====
+// A servo draws most just after it starts moving, and six starting at once
+// browns out a USB-powered board. Dots that change together are started
+// on a staggered plan that keeps the modelled supply current within
+// SERVO_CURRENT_BUDGET_MA: each dot draws SERVO_INRUSH_MA for
+// SERVO_INRUSH_MS after its start, then SERVO_MOVE_MA until it settles.
+// One dot may always start on its own. SERVO_STAGGER_MAX_MS after show()
+// the plan stops waiting for moving dots and only keeps the inrushes
+// within budget, so a line of n changed dots is fully formed at worst
+// SERVO_STAGGER_MAX_MS + ceil(n / (budget / inrush)) * SERVO_INRUSH_MS +
+// SERVO_SETTLE_MS after show(); a single cell's six dots take ~40 ms
+// longer than unstaggered with the defaults. commandAll() is not capped:
+// boot and calibration moves keep to the whole budget however long.
+#ifndef SERVO_INRUSH_MS
+#define SERVO_INRUSH_MS 20UL
+#endif
+#ifndef SERVO_INRUSH_MA
+#define SERVO_INRUSH_MA 500UL   // SG90 class, close to stall
+#endif
+#ifndef SERVO_MOVE_MA
+#define SERVO_MOVE_MA 150UL
+#endif
+#ifndef SERVO_CURRENT_BUDGET_MA
+#define SERVO_CURRENT_BUDGET_MA 1500UL
+#endif
+#ifndef SERVO_STAGGER_MAX_MS
+#define SERVO_STAGGER_MAX_MS 120UL
+#endif
+
+class LineDisplay {
+ public:
+  explicit LineDisplay(CellOutput& output) : output_(output) {}
+
+  // Plans the dots that differ from line() (see Inrush Budget), commands
+  // those due now with one driver flush and records when the line will
+  // be fully formed. Later starts need service().
+  void show(const uint8_t line[DISPLAY_CELLS], unsigned long nowMs);
+
+  // Commands every dot, e.g. at boot when positions are unknown or after
+  // a calibration change.
+  void commandAll(const uint8_t line[DISPLAY_CELLS], unsigned long nowMs);
+
+  // Commands the planned dots whose start has come, one flush for all
+  void service(unsigned long nowMs);
+
+  // When the next planned dot starts; false if none are waiting
+  bool nextStartAt(unsigned long& startAt) const;
+
+  // Stops the servo pulses (CellOutput::release); the next command
+  // resumes them.
+  void release();
+
+  const uint8_t* line() const { return line_; }
+  unsigned long settledAt() const { return settledAt_; }   // When every dot of line() is in place, as planned
+  bool released() const { return released_; }
+
+ private:
+  void commandCell(size_t cell, uint8_t mask, unsigned long nowMs);
+  void plan(unsigned long nowMs, unsigned long maxDelayMs);
+  void unplan(size_t cell, unsigned long nowMs);
+  unsigned long currentMaAt(unsigned long t, bool inrushOnly) const;
+  unsigned long nextDropAfter(unsigned long t) const;
+  void updateSettledAt(unsigned long nowMs);
+
+  CellOutput& output_;
+  uint8_t line_[DISPLAY_CELLS] = {};                   // Patterns shown, including dots still to start
+  uint8_t commanded_[DISPLAY_CELLS] = {};              // Patterns sent to the driver
+  unsigned long dotStartAt_[DISPLAY_CELLS][6] = {};    // When each dot starts (or started) its last move
+  unsigned long dotSettleAt_[DISPLAY_CELLS][6] = {};   // When each dot finishes its last move
+  unsigned long settledAt_ = 0;
+  bool released_ = false;
+};
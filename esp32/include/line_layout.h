@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "cell_queue.h"
+
+// ===== Line Layout =====
+// As many queued cells as fit on a line of `width` cells; a word that
+// would be split is moved to the next line unless it is longer than the
+// whole line. The first cell of a timed frame, and any cell flagged
+// QUEUED_CELL_BREAK, always starts a new line.
+// Consumer side of the queue (see cell_queue.h).
+template <size_t Capacity>
+size_t nextLineLength(const CellQueue<Capacity>& queue, size_t width) {
+  size_t pending = queue.size();
+  QueuedCell cell;
+  for (size_t k = 1; k < pending && k < width; k++) {
+    queue.peek(k, cell);
+    if (cell.flags & (QUEUED_CELL_TIMED | QUEUED_CELL_BREAK)) {
+      return k;             // A timed frame shows on a line of its own
+    }
+  }
+  if (pending <= width) {
+    return pending;
+  }
+  queue.peek(width, cell);
+  if (cell.pattern == 0) {
+    return width;           // The line ends right before a space
+  }
+  for (size_t k = width; k > 1; k--) {
+    queue.peek(k - 1, cell);
+    if (cell.pattern == 0) {
+      return k;             // Break after the last space on the line
+    }
+  }
+  return width;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_queue.h"
+#include "latency.h"
+#include "line_display.h"
+#include "line_layout.h"
+#include "log.h"
+#include "pace.h"
+
+// ===== Line Player =====
+// Paced playback of a cell queue onto a LineDisplay. Each line is held
+// for the paced dwell of its cells (pace.h) after its dots settle. With a
+// gap configured, the dots drop between lines and stay down for the gap
+// once settled. A timed frame starts its line at its show-at time
+// instead, cutting the line before it short if need be, so the sender
+// owns the timeline.
+//
+// Like LineDisplay it takes the time (and the pace) from the caller, so
+// the scheduling builds and is timed in the native env. Consumer side of
+// the queue (see cell_queue.h).
+struct LinePace {
+  uint16_t dwellMs;       // 0 = the player's default dwell
+  uint16_t gapMs;
+  uint8_t flags;          // PACE_FLAG_*
+  uint8_t speedPercent;
+};
+
+enum LineStep : uint8_t {
+  LINE_STEP_NONE,   // Nothing due yet
+  LINE_STEP_GAP,    // The dots dropped for the gap
+  LINE_STEP_LINE,   // The next line went up
+};
+
+struct PlayedLine {
+  size_t count;
+  QueuedCell cells[DISPLAY_CELLS];
+};
+
+template <size_t Capacity>
+class LinePlayer {
+ public:
+  LinePlayer(LineDisplay& display, CellQueue<Capacity>& queue, unsigned long defaultDwellMs)
+      : display_(display), queue_(queue), defaultDwellMs_(defaultDwellMs), dwellMs_(defaultDwellMs) {}
+
+  // When the next line (or gap) is due; false if nothing is queued
+  bool nextDueAt(unsigned long& dueAt) const {
+    QueuedCell front;
+    if (!queue_.peek(0, front)) {
+      return false;
+    }
+    dueAt = front.flags & QUEUED_CELL_TIMED ? front.showAtMs : display_.settledAt() + dwellMs_;
+    return true;
+  }
+
+  // Shows the gap or the next line if it is due at `nowMs`; the cells of
+  // a line are popped into `played` for the caller's acks and latency.
+  LineStep advance(unsigned long nowMs, const LinePace& pace, PlayedLine& played) {
+    unsigned long dueAt;
+    if (!nextDueAt(dueAt) || (long)(nowMs - dueAt) < 0) {
+      return LINE_STEP_NONE;
+    }
+
+    QueuedCell front;
+    queue_.peek(0, front);
+    if (pace.gapMs > 0 && !gapShown_ && !(front.flags & QUEUED_CELL_TIMED)) {
+      uint8_t blank[DISPLAY_CELLS] = {};
+      display_.show(blank, nowMs);
+      dwellMs_ = pace.gapMs;
+      gapShown_ = true;
+      return LINE_STEP_GAP;
+    }
+    gapShown_ = false;
+
+    uint8_t line[DISPLAY_CELLS] = {};
+    played.count = nextLineLength(queue_, DISPLAY_CELLS);
+    dwellMs_ = 0;
+    for (size_t c = 0; c < played.count; c++) {
+      QueuedCell& cell = played.cells[c];
+      queue_.pop(cell);
+      line[c] = cell.pattern;
+      dwellMs_ += pacedDwellMs(cell.dwellMs, pace.flags, pace.dwellMs, pace.speedPercent, defaultDwellMs_);
+
+      LOG_DEBUG("Braille pattern (binary): %d%d%d%d%d%d",
+                (line[c] >> 5) & 1, (line[c] >> 4) & 1, (line[c] >> 3) & 1,
+                (line[c] >> 2) & 1, (line[c] >> 1) & 1, line[c] & 1);
+    }
+
+    uint32_t commandStartUs = latencyNow();
+    display_.show(line, nowMs);
+    latencyRecord(LATENCY_COMMAND, commandStartUs);
+    return LINE_STEP_LINE;
+  }
+
+  unsigned long dwellMs() const { return dwellMs_; }   // Of the line (or gap) on display
+
+ private:
+  LineDisplay& display_;
+  CellQueue<Capacity>& queue_;
+  unsigned long defaultDwellMs_;
+  unsigned long dwellMs_;
+  bool gapShown_ = false;   // The gap before the next line is up
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/select.h>
+
+// ===== Local WebSocket Link =====
+// A WebSocket server (RFC 6455) on the LAN next to the MQTT client, so a
+// backend on the same network reaches the display in a few ms instead of
+// a round trip through the cloud broker. Each binary message carries one
+// MQTT message:
+//   0      topic length n
+//   1..n   topic, as on the broker (e.g. braille/<device id>/cells)
+//   n+1..  payload
+// Incoming messages go through the callback (the firmware passes the
+// low-latency kinds on to the MQTT callback), so cell frames keep their
+// sequence numbers and duplicates from the broker are dropped.
+//
+// One client at a time. A new connection waits in a pending slot until
+// its upgrade request (GET /braille) carries the shared key in an
+// "Authorization: Bearer <key>" header, and only then replaces the
+// current client, so an unauthorized host cannot knock it off. Runs on
+// non-blocking lwIP sockets from the network task and never allocates.
+const uint16_t LOCAL_LINK_PORT = 8765;
+const size_t LOCAL_LINK_TOPIC_MAX = 63;
+// Holds anything the MQTT buffer does: a WebSocket header is at most
+// 14 bytes, the MQTT one 7, so 16 spare covers it plus the topic length
+const size_t LOCAL_LINK_BUFFER_SIZE = MQTT_MAX_PACKET_SIZE + 16;
+const size_t LOCAL_LINK_HANDSHAKE_MAX = 1024;   // Upgrade request headers
+const unsigned long LOCAL_LINK_HANDSHAKE_TIMEOUT_MS = 2000;
+
+typedef void (*LocalLinkCallback)(char* topic, uint8_t* payload, unsigned int length);
+
+class LocalLink {
+ public:
+  // Starts listening; true if already listening
+  bool begin(uint16_t port, const char* key);
+  void setCallback(LocalLinkCallback callback) { callback_ = callback; }
+
+  // Adds the listening, client and pending sockets to a select() set
+  void addFds(fd_set& readable, int& maxFd) const;
+
+  // Accepts, reads and dispatches whatever is pending; never blocks
+  void service(unsigned long nowMs);
+
+  bool listening() const { return listenFd_ >= 0; }
+  bool connected() const { return clientFd_ >= 0; }
+  bool publish(const char* topic, const uint8_t* payload, size_t length);
+
+  // Drops the client and any pending one, e.g. when WiFi goes down;
+  // keeps listening
+  void disconnect();
+
+ private:
+  void acceptClient(unsigned long nowMs);
+  void readPending();
+  void readHandshake();
+  bool readFrames();
+  void dispatch(uint8_t* data, size_t length);
+  bool sendFrame(uint8_t opcode, const uint8_t* head, size_t headLength, const uint8_t* body, size_t bodyLength);
+  void close(uint16_t code);
+  void closeClient();
+  void closePending();
+
+  int listenFd_ = -1;
+  int clientFd_ = -1;    // Upgraded and authorized
+  int pendingFd_ = -1;   // Accepted, upgrade request not yet checked
+  const char* key_ = "";
+  LocalLinkCallback callback_ = nullptr;
+  unsigned long pendingAt_ = 0;
+  size_t rxLength_ = 0;
+  size_t pendingLength_ = 0;
+  uint8_t rx_[LOCAL_LINK_BUFFER_SIZE];
+  char pendingRx_[LOCAL_LINK_HANDSHAKE_MAX + 1];   // + NUL for parsing
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+
+// ===== Logging =====
+// Compile-time log levels: set LOG_LEVEL through build_flags in
+// platformio.ini. Messages above the configured level compile to nothing,
+// so production builds carry no per-cell debug formatting at all.
+//
+// Enabled messages are formatted into a RAM ring buffer and written to
+// Serial by a low-priority drain task, so callers (MQTT callback, servo
+// updates) never block on the UART.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 2048      // Bytes of pending output before messages are dropped
+#endif
+
+#define LOG_LINE_MAX 160          // Longest single formatted message
+
+// Starts the drain task, which sleeps until a message is logged. Messages
+// logged before this are kept and flushed.
+void logBegin();
+
+// Formats one message into the ring buffer; never blocks on Serial.
+void logWrite(char level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) logWrite('E', fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) logWrite('W', fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) logWrite('I', fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) logWrite('D', fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do {} while (0)
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Reading Pace =====
+// How long each cell stays up, set per learner with a retained message on
+// braille/<device id>/pace so it is reapplied on every (re)connect.
+// Fixed-layout binary, multi-byte fields big-endian like cell_frame.h:
+//   0    version (PACE_VERSION)
+//   1    flags (PACE_FLAG_*)
+//   2-3  dwell per cell in ms, 0 = firmware default (CELL_DWELL_MS)
+//   4-5  gap between lines in ms: the dots drop and stay down this long
+//        after settling, so repeated cells read as separate
+//   6    speed in percent; dwells are scaled by 100 / speed
+//   7    slowest speed the learner can nudge to, in percent
+//   8    fastest speed the learner can nudge to, in percent
+//
+// A one-byte payload on the same topic is a learner nudge (see
+// paceNudge): '+' faster, '-' slower, '=' back to the configured speed.
+const uint8_t PACE_VERSION = 1;
+const size_t PACE_CONFIG_SIZE = 9;
+const uint8_t PACE_FLAG_ADAPTIVE = 0x01;   // Learner nudges allowed
+const uint8_t PACE_FLAG_OVERRIDE = 0x02;   // Dwell also replaces the dwells of cell frames and lessons
+const uint8_t PACE_NUDGE_PERCENT = 10;
+const uint8_t PACE_SPEED_MIN = 10;
+const uint8_t PACE_SPEED_MAX = 250;
+
+struct PaceConfig {
+  uint8_t flags;
+  uint16_t dwellMs;
+  uint16_t gapMs;
+  uint8_t speedPercent;
+  uint8_t minSpeedPercent;
+  uint8_t maxSpeedPercent;
+};
+
+const PaceConfig PACE_DEFAULT = {0, 0, 0, 100, 100, 100};
+
+inline bool parsePaceConfig(const uint8_t* data, size_t length, PaceConfig& pace) {
+  if (length != PACE_CONFIG_SIZE || data[0] != PACE_VERSION) {
+    return false;
+  }
+  pace.flags = data[1];
+  pace.dwellMs = (uint16_t)data[2] << 8 | data[3];
+  pace.gapMs = (uint16_t)data[4] << 8 | data[5];
+  pace.speedPercent = data[6];
+  pace.minSpeedPercent = data[7];
+  pace.maxSpeedPercent = data[8];
+  return pace.minSpeedPercent >= PACE_SPEED_MIN && pace.maxSpeedPercent <= PACE_SPEED_MAX &&
+         pace.minSpeedPercent <= pace.speedPercent && pace.speedPercent <= pace.maxSpeedPercent;
+}
+
+// Applies a nudge to the current speed; false if it is not a nudge or the
+// config does not allow them
+inline bool paceNudge(const PaceConfig& config, uint8_t nudge, uint8_t& speedPercent) {
+  if (!(config.flags & PACE_FLAG_ADAPTIVE)) {
+    return false;
+  }
+  int speed = speedPercent;
+  switch (nudge) {
+    case '+':
+      speed += PACE_NUDGE_PERCENT;
+      break;
+    case '-':
+      speed -= PACE_NUDGE_PERCENT;
+      break;
+    case '=':
+      speed = config.speedPercent;
+      break;
+    default:
+      return false;
+  }
+  speed = speed < config.minSpeedPercent ? config.minSpeedPercent : speed;
+  speed = speed > config.maxSpeedPercent ? config.maxSpeedPercent : speed;
+  speedPercent = speed;
+  return true;
+}
+
+// Dwell of one queued cell: its own dwell (0 if it has none) unless the
+// pace overrides it, the pace or firmware default otherwise, at the
+// current speed
+inline uint32_t pacedDwellMs(uint16_t cellDwellMs, uint8_t flags, uint16_t paceDwellMs, uint8_t speedPercent,
+                             uint32_t defaultDwellMs) {
+  uint32_t dwell = cellDwellMs;
+  if (dwell == 0 || (flags & PACE_FLAG_OVERRIDE && paceDwellMs)) {
+    dwell = paceDwellMs ? paceDwellMs : defaultDwellMs;
+  }
+  return dwell * 100 / (speedPercent ? speedPercent : 100);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_frame.h"
+#include "lesson.h"
+
+// ===== Quiz Bundles =====
+// Questions together with their expected answers in one message on
+// <scope>/quiz, so the device checks every answer itself and moves on at
+// once instead of waiting for a round trip per question. Each item's
+// prompt is shown on its own line until the learner writes the answer on
+// the dot keys (Answer Keys below). Multi-byte fields are big-endian:
+//   0      version (QUIZ_VERSION)
+//   1      flags, reserved (0)
+//   2-5    quiz id
+//   6-7    item count
+//   8..    items, each:
+//            0    expected answer, a 6-bit cell
+//            1-2  prompt cell count, 0 if the prompt is given elsewhere
+//                 (e.g. spoken by the frontend)
+//            3..  prompt cells packed as in cell_frame.h
+const uint8_t QUIZ_VERSION = 1;
+const size_t QUIZ_HEADER_SIZE = 8;
+const size_t QUIZ_ITEM_HEADER_SIZE = 3;
+const size_t QUIZ_MAX_SIZE = 1024;   // Copied to RAM while the quiz runs
+
+struct QuizBundle {
+  uint32_t id;
+  uint16_t itemCount;
+  const uint8_t* items;
+  size_t itemsLength;
+};
+
+struct QuizItem {
+  uint8_t answer;
+  CellFrame prompt;   // Cells only, no sequence or dwell
+};
+
+// Reads the item at `offset` and advances `offset` past it; false at the
+// end or if it is truncated.
+inline bool quizNextItem(const QuizBundle& quiz, size_t& offset, QuizItem& item) {
+  if (offset > quiz.itemsLength || quiz.itemsLength - offset < QUIZ_ITEM_HEADER_SIZE) {
+    return false;
+  }
+  const uint8_t* p = quiz.items + offset;
+  item.answer = p[0] & 0x3F;
+  item.prompt = {};
+  item.prompt.cellCount = cellFrameRead16(p + 1);
+  item.prompt.packed = p + QUIZ_ITEM_HEADER_SIZE;
+  size_t size = QUIZ_ITEM_HEADER_SIZE + cellFramePackedSize(item.prompt.cellCount);
+  if (quiz.itemsLength - offset < size) {
+    return false;
+  }
+  offset += size;
+  return true;
+}
+
+// Validates the header and that every item is complete
+inline bool parseQuizBundle(const uint8_t* data, size_t length, QuizBundle& quiz) {
+  if (length < QUIZ_HEADER_SIZE || data[0] != QUIZ_VERSION) {
+    return false;
+  }
+  quiz.id = lessonRead32(data + 2);
+  quiz.itemCount = cellFrameRead16(data + 6);
+  quiz.items = data + QUIZ_HEADER_SIZE;
+  quiz.itemsLength = length - QUIZ_HEADER_SIZE;
+
+  size_t offset = 0;
+  QuizItem item;
+  for (uint16_t i = 0; i < quiz.itemCount; i++) {
+    if (!quizNextItem(quiz, offset, item)) {
+      return false;
+    }
+  }
+  return offset == quiz.itemsLength;
+}
+
+// ===== Quiz Results =====
+// Answers are reported in batches on <mqtt_topic_quiz_results>/<device id>
+// rather than one message each:
+//   0      version (QUIZ_VERSION)
+//   1      flags (QUIZ_RESULTS_FLAG_*)
+//   2-5    quiz id
+//   6      result count
+//   7..    results, each:
+//            0-1  item index
+//            2    cell written | QUIZ_RESULT_*
+//            3-4  response time in ms from the prompt being due on the
+//                 display, saturating at 65535
+const size_t QUIZ_RESULTS_HEADER_SIZE = 7;
+const size_t QUIZ_RESULT_SIZE = 5;
+const uint8_t QUIZ_RESULTS_FLAG_FINISHED = 0x01;   // Last batch: every item was answered
+const uint8_t QUIZ_RESULT_CORRECT = 0x40;
+const uint8_t QUIZ_RESULT_SKIPPED = 0x80;          // Next pressed instead of an answer
+
+struct QuizResult {
+  uint16_t item;
+  uint8_t answer;       // Cell | QUIZ_RESULT_*
+  uint16_t responseMs;
+};
+
+constexpr size_t quizResultsSize(size_t count) {
+  return QUIZ_RESULTS_HEADER_SIZE + count * QUIZ_RESULT_SIZE;
+}
+
+inline size_t encodeQuizResults(uint32_t id, uint8_t flags, const QuizResult* results, uint8_t count,
+                                uint8_t* out) {
+  out[0] = QUIZ_VERSION;
+  out[1] = flags;
+  for (int i = 0; i < 4; i++) {
+    out[2 + i] = id >> (24 - 8 * i);
+  }
+  out[6] = count;
+  uint8_t* p = out + QUIZ_RESULTS_HEADER_SIZE;
+  for (uint8_t i = 0; i < count; i++, p += QUIZ_RESULT_SIZE) {
+    p[0] = results[i].item >> 8;
+    p[1] = results[i].item & 0xFF;
+    p[2] = results[i].answer;
+    p[3] = results[i].responseMs >> 8;
+    p[4] = results[i].responseMs & 0xFF;
+  }
+  return quizResultsSize(count);
+}
+
+// ===== Answer Keys =====
+// Six dot keys and a next key. An answer is written as a chord, like on a
+// Perkins brailler: every dot key pressed since the first went down adds
+// its dot, and the chord is complete once all of them are released. Key
+// masks use the cell bits (braille_table.h, dot 1 = bit 5) for the dot
+// keys and QUIZ_KEY_NEXT for next, which skips the item.
+const uint8_t QUIZ_KEY_DOTS = 0b111111;
+const uint8_t QUIZ_KEY_NEXT = 1 << 6;
+
+enum QuizKeyEvent : uint8_t {
+  QUIZ_KEYS_NONE,
+  QUIZ_KEYS_CHORD,   // `chord` holds the answer
+  QUIZ_KEYS_NEXT,
+};
+
+class QuizKeys {
+ public:
+  // `down` are the keys held now, `pressed` those that went down since
+  // the last call (a tap may be over before it is seen held).
+  QuizKeyEvent update(uint8_t down, uint8_t pressed, uint8_t& chord) {
+    pressed |= down & ~down_;
+    down_ = down;
+    if (pressed & QUIZ_KEY_NEXT) {
+      chord_ = 0;
+      return QUIZ_KEYS_NEXT;
+    }
+    chord_ |= (down | pressed) & QUIZ_KEY_DOTS;
+    if (chord_ && !(down & QUIZ_KEY_DOTS)) {
+      chord = chord_;
+      chord_ = 0;
+      return QUIZ_KEYS_CHORD;
+    }
+    return QUIZ_KEYS_NONE;
+  }
+
+  // Drops a half-written chord, e.g. when a new item comes up
+  void reset() { chord_ = 0; }
+
+ private:
+  uint8_t down_ = 0;
+  uint8_t chord_ = 0;
+};
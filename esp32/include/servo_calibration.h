@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_output.h"
+
+// ===== Servo Calibration =====
+// Per-cell, per-dot raised/lowered pulse widths, loaded from NVS at boot into
+// dotPulseUs so the hot path is a single table read per dot. The table is
+// indexed by cell bit (braille_table.h), so braille dot d is index 6 - d.
+// Defaults reproduce the original wiring: the servos on bits 0-2 (dots
+// 6-4) rotate 0° -> 90° to raise, those on bits 3-5 (dots 3-1) are
+// mounted the other way round and rotate 90° -> 0°.
+const uint16_t SERVO_MIN_PULSE_US = 500;    // 0°
+const uint16_t SERVO_MAX_PULSE_US = 2400;   // 180°
+
+// [cell][bit 0-5][0 = lowered, 1 = raised]
+extern uint16_t dotPulseUs[DISPLAY_CELLS][6][2];
+
+void loadServoCalibration();
+void resetServoCalibration();
+
+// Updates one dot (cell 0.., bit 0-5) live and persists the table. Returns
+// false if a pulse width is outside SERVO_MIN_PULSE_US..SERVO_MAX_PULSE_US.
+bool setDotCalibration(int cell, int bit, uint16_t raisedUs, uint16_t loweredUs);
+
+// Text command from the calibration topic, with braille dot numbers:
+//   "<dot 1-6> <raised_us> <lowered_us>"         trim a dot of the first cell
+//   "<cell 1..> <dot 1-6> <raised_us> <lowered_us>"  trim a dot of any cell
+//   "reset"                                      restore the defaults
+bool handleCalibrationCommand(const uint8_t* payload, size_t length);
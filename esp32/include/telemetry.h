@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Device Telemetry =====
+// Published every TELEMETRY_INTERVAL_MS on <mqtt_topic_telemetry>/<device id>.
+// Fixed-layout binary, multi-byte fields big-endian like cell_frame.h:
+//   0      version (TELEMETRY_VERSION)
+//   1      flags, reserved (0)
+//   2-5    uptime in s
+//   6-9    free heap in bytes
+//   10-13  minimum free heap since boot
+//   14-17  longest network task iteration in µs, this interval
+//   18-21  longest actuation task iteration in µs, this interval
+//   22-23  MQTT messages processed this interval
+//   24-25  interval length in s
+//   26-27  cell queue depth
+//   28-29  WiFi reconnects since boot
+//   30-31  MQTT reconnects since boot
+//   32     RSSI in dBm (signed)
+const uint8_t TELEMETRY_VERSION = 1;
+const size_t TELEMETRY_SIZE = 33;
+
+struct TelemetrySample {
+  uint32_t uptimeS;
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;
+  uint32_t networkLoopMaxUs;
+  uint32_t actuationLoopMaxUs;
+  uint16_t messages;
+  uint16_t intervalS;
+  uint16_t queueDepth;
+  uint16_t wifiReconnects;
+  uint16_t mqttReconnects;
+  int8_t rssi;
+};
+
+inline uint8_t* telemetryWrite16(uint8_t* p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+  return p + 2;
+}
+
+inline uint8_t* telemetryWrite32(uint8_t* p, uint32_t v) {
+  return telemetryWrite16(telemetryWrite16(p, v >> 16), v);
+}
+
+inline size_t encodeTelemetry(const TelemetrySample& s, uint8_t out[TELEMETRY_SIZE]) {
+  uint8_t* p = out;
+  *p++ = TELEMETRY_VERSION;
+  *p++ = 0;
+  p = telemetryWrite32(p, s.uptimeS);
+  p = telemetryWrite32(p, s.freeHeap);
+  p = telemetryWrite32(p, s.minFreeHeap);
+  p = telemetryWrite32(p, s.networkLoopMaxUs);
+  p = telemetryWrite32(p, s.actuationLoopMaxUs);
+  p = telemetryWrite16(p, s.messages);
+  p = telemetryWrite16(p, s.intervalS);
+  p = telemetryWrite16(p, s.queueDepth);
+  p = telemetryWrite16(p, s.wifiReconnects);
+  p = telemetryWrite16(p, s.mqttReconnects);
+  *p++ = (uint8_t)s.rssi;
+  return p - out;
+}
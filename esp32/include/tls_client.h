@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Client.h>
+#include <WiFiClient.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+// ===== Resumable TLS Client =====
+// TLS over WiFiClient using mbedtls directly. WiFiClientSecure always does
+// a full handshake; this client keeps the negotiated session (ticket or
+// session ID) in RTC memory and offers it on the next connect, so
+// reconnects (and warm resets) skip the certificate exchange and key
+// agreement when the broker accepts it.
+//
+// The server certificate is always verified against the CA from
+// setCACert(), including the host name.
+const size_t TLS_SESSION_CACHE_SIZE = 2048;   // Serialized session, incl. peer certificate
+
+class TlsClient : public Client {
+ public:
+  TlsClient();
+  ~TlsClient() override;
+
+  // PEM, kept by reference; must be set before the first connect
+  void setCACert(const char* pem) { caPem_ = pem; }
+  // Also bounds how long a write waits for a stalled peer
+  void setHandshakeTimeout(unsigned long seconds) { handshakeTimeoutMs_ = seconds * 1000; }
+
+  // Underlying socket, e.g. for select(); -1 when not connected
+  int fd() const { return tcp_.fd(); }
+
+  // True if the last handshake resumed a cached session
+  bool sessionResumed() const { return resumed_; }
+
+  // Forgets the cached session, e.g. after the broker rejected it
+  static void clearSessionCache();
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+ private:
+  bool configure();
+  bool handshake();
+  bool saveSession();
+
+  WiFiClient tcp_;
+  mbedtls_entropy_context entropy_;
+  mbedtls_ctr_drbg_context drbg_;
+  mbedtls_x509_crt ca_;
+  mbedtls_ssl_config conf_;
+  mbedtls_ssl_context ssl_;
+
+  const char* caPem_ = nullptr;
+  unsigned long handshakeTimeoutMs_ = 10000;
+  bool configured_ = false;   // conf_/ssl_ set up; only reset between connections
+  bool secure_ = false;       // Handshake completed on the current socket
+  bool resumed_ = false;
+  int peeked_ = -1;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// ===== Host Preferences =====
+// In-memory NVS for the native env: blobs and strings per namespace/key,
+// kept for the life of the process. Only the calls the firmware makes.
+class Preferences {
+ public:
+  bool begin(const char* name, bool /* readOnly */ = false) {
+    namespace_ = name;
+    return true;
+  }
+  void end() {}
+
+  size_t putBytes(const char* key, const void* value, size_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    store()[path(key)].assign(bytes, bytes + length);
+    return length;
+  }
+  size_t getBytesLength(const char* key) {
+    auto it = store().find(path(key));
+    return it == store().end() ? 0 : it->second.size();
+  }
+  size_t getBytes(const char* key, void* buf, size_t maxLength) {
+    auto it = store().find(path(key));
+    if (it == store().end() || it->second.size() > maxLength) {
+      return 0;
+    }
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+  size_t putString(const char* key, const char* value) {
+    return putBytes(key, value, strlen(value) + 1);
+  }
+  size_t getString(const char* key, char* value, size_t maxLength) {
+    return getBytes(key, value, maxLength);
+  }
+
+  bool remove(const char* key) { return store().erase(path(key)) > 0; }
+
+ private:
+  std::string path(const char* key) const { return namespace_ + "/" + key; }
+  static std::map<std::string, std::vector<uint8_t>>& store() {
+    static std::map<std::string, std::vector<uint8_t>> values;
+    return values;
+  }
+
+  std::string namespace_;
+};
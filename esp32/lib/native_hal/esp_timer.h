@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+
+// ===== Host esp_timer =====
+// Monotonic µs since some fixed point, like esp_timer_get_time() on the
+// device (which counts from boot).
+inline int64_t esp_timer_get_time() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
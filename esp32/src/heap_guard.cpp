@@ -0,0 +1,38 @@
+#include "heap_guard.h"
+
+#if HEAP_GUARD
+
+#include <assert.h>
+
+TaskHandle_t HeapGuard::guardedTask = nullptr;
+
+// Only the guarded task itself is refused; other tasks (WiFi, lwIP) keep
+// allocating while it runs
+static inline void heapGuardCheck() {
+  TaskHandle_t guarded = HeapGuard::guardedTask;
+  assert(guarded == nullptr || guarded != xTaskGetCurrentTaskHandle());
+  (void)guarded;
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  heapGuardCheck();
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  heapGuardCheck();
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  heapGuardCheck();
+  return __real_realloc(ptr, size);
+}
+}
+
+#endif
@@ -0,0 +1,16 @@
+#include "cell_output.h"
+
+#if DISPLAY_DRIVER == DISPLAY_DRIVER_HOST
+
+#include "host_output.h"
+
+HostOutput& hostOutput() {
+  static HostOutput output;
+  return output;
+}
+
+CellOutput& displayOutput() {
+  return hostOutput();
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "latency.h"
+#include "log.h"
+
+// ===== Latency Histograms =====
+struct LatencyHistogram {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+static const char* const LATENCY_STAGE_NAMES[LATENCY_STAGE_COUNT] = {
+  "decode", "enqueue", "command", "total"
+};
+
+static LatencyHistogram histograms[LATENCY_STAGE_COUNT];
+
+// Set by latencyReset(); reports treat a pending stage as empty
+static std::atomic<bool> resetPending[LATENCY_STAGE_COUNT];
+
+static size_t latencyBucket(uint32_t us) {
+  size_t bucket = 31 - __builtin_clz(us | 1);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+void latencyRecord(LatencyStage stage, uint32_t startUs) {
+  uint32_t us = latencyNow() - startUs;
+  LatencyHistogram& h = histograms[stage];
+  if (resetPending[stage].exchange(false)) {
+    h = {};
+  }
+  h.buckets[latencyBucket(us)]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) {
+    h.maxUs = us;
+  }
+}
+
+void latencyReset() {
+  for (size_t s = 0; s < LATENCY_STAGE_COUNT; s++) {
+    resetPending[s] = true;
+  }
+}
+
+// Copies a stage for reporting; the owning task may be recording meanwhile,
+// which can skew a snapshot by one sample at most.
+static LatencyHistogram latencySnapshot(size_t stage) {
+  if (resetPending[stage]) {
+    return {};
+  }
+  return histograms[stage];
+}
+
+// Upper edge of the bucket holding the given fraction of samples
+static uint32_t latencyPercentileUs(const LatencyHistogram& h, uint32_t permille) {
+  uint64_t target = ((uint64_t)h.count * permille + 999) / 1000;
+  uint64_t seen = 0;
+  for (size_t k = 0; k < LATENCY_BUCKETS; k++) {
+    seen += h.buckets[k];
+    if (seen >= target) {
+      return k + 1 < LATENCY_BUCKETS ? 1UL << (k + 1) : h.maxUs;
+    }
+  }
+  return h.maxUs;
+}
+
+LatencySummary latencySummary(LatencyStage stage) {
+  LatencyHistogram h = latencySnapshot(stage);
+  if (h.count == 0) {
+    return {};
+  }
+  return {h.count, (uint32_t)(h.sumUs / h.count), latencyPercentileUs(h, 500),
+          latencyPercentileUs(h, 990), h.maxUs};
+}
+
+void latencyLogReport() {
+  for (size_t s = 0; s < LATENCY_STAGE_COUNT; s++) {
+    LatencySummary summary = latencySummary((LatencyStage)s);
+    if (summary.count == 0) {
+      LOG_INFO("latency %s: no samples", LATENCY_STAGE_NAMES[s]);
+      continue;
+    }
+    LOG_INFO("latency %s: n=%u mean=%uus p50<%uus p99<%uus max=%uus",
+             LATENCY_STAGE_NAMES[s], (unsigned)summary.count, (unsigned)summary.meanUs,
+             (unsigned)summary.p50Us, (unsigned)summary.p99Us, (unsigned)summary.maxUs);
+  }
+}
+
+size_t latencyFormatJson(char* out, size_t size) {
+  size_t len = 0;
+  auto append = [&](const char* fmt, auto... args) {
+    if (len < size) {
+      int n = snprintf(out + len, size - len, fmt, args...);
+      len += n < 0 ? size : (size_t)n;
+    }
+  };
+
+  append("{\"unit\":\"us\",\"buckets\":\"log2\"");
+  for (size_t s = 0; s < LATENCY_STAGE_COUNT; s++) {
+    LatencyHistogram h = latencySnapshot(s);
+    append(",\"%s\":{\"n\":%u,\"mean\":%u,\"max\":%u,\"hist\":[", LATENCY_STAGE_NAMES[s],
+           (unsigned)h.count, (unsigned)(h.count ? h.sumUs / h.count : 0), (unsigned)h.maxUs);
+    for (size_t k = 0; k < LATENCY_BUCKETS; k++) {
+      append(k ? ",%u" : "%u", (unsigned)h.buckets[k]);
+    }
+    append("]}");
+  }
+  append("}");
+  return len < size ? len : 0;
+}
@@ -0,0 +1,162 @@
+#include <esp_partition.h>
+#include <stddef.h>
+#include <string.h>
+#include "lesson_cache.h"
+#include "log.h"
+
+// ===== Sector Layout =====
+// Header, then the bundle as received. The header is written last, so a
+// sector cut off by a reset fails its checksum and reads as free.
+const uint32_t LESSON_SLOT_MAGIC = 0x1E550001;
+
+struct LessonSlotHeader {
+  uint32_t magic;
+  uint32_t id;
+  uint32_t hash;
+  uint32_t sequence;      // Store order, for replacing the oldest
+  uint32_t length;        // Bundle bytes
+  uint32_t checksum;      // FNV-1a over the fields above
+};
+
+static_assert(sizeof(LessonSlotHeader) <= LESSON_SLOT_HEADER_SIZE, "slot header too large");
+
+struct LessonSlot {
+  bool used;
+  uint32_t id;
+  uint32_t hash;
+  uint32_t sequence;
+  uint32_t length;
+};
+
+static const esp_partition_t* lessonPartition = nullptr;
+static LessonSlot slots[LESSON_SLOTS_MAX];
+static size_t slotCount = 0;
+static uint32_t nextSequence = 1;
+
+static int openSlot = -1;
+static esp_partition_mmap_handle_t openHandle;
+
+static uint32_t slotChecksum(const LessonSlotHeader& header) {
+  return lessonHash(reinterpret_cast<const uint8_t*>(&header), offsetof(LessonSlotHeader, checksum));
+}
+
+bool lessonCacheBegin() {
+  lessonPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "lessons");
+  if (!lessonPartition) {
+    LOG_WARN("No lessons partition, lesson cache disabled");
+    return false;
+  }
+  slotCount = lessonPartition->size / LESSON_SLOT_SIZE;
+  if (slotCount > LESSON_SLOTS_MAX) {
+    slotCount = LESSON_SLOTS_MAX;
+  }
+
+  size_t cached = 0;
+  for (size_t i = 0; i < slotCount; i++) {
+    LessonSlotHeader header;
+    slots[i] = {};
+    if (esp_partition_read(lessonPartition, i * LESSON_SLOT_SIZE, &header, sizeof(header)) != ESP_OK ||
+        header.magic != LESSON_SLOT_MAGIC || header.checksum != slotChecksum(header) ||
+        header.length > LESSON_MAX_SIZE) {
+      continue;
+    }
+    slots[i] = {true, header.id, header.hash, header.sequence, header.length};
+    if ((int32_t)(header.sequence - nextSequence) >= 0) {
+      nextSequence = header.sequence + 1;
+    }
+    cached++;
+  }
+  LOG_INFO("Lesson cache: %u of %u slots used", (unsigned)cached, (unsigned)slotCount);
+  return true;
+}
+
+static int findSlot(uint32_t id, uint32_t hash) {
+  for (size_t i = 0; i < slotCount; i++) {
+    if (slots[i].used && slots[i].id == id && slots[i].hash == hash) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool lessonCacheContains(uint32_t id, uint32_t hash) {
+  return findSlot(id, hash) >= 0;
+}
+
+// Same id (an older version), else free, else the oldest
+static int chooseSlot(uint32_t id) {
+  int oldest = -1;
+  for (size_t i = 0; i < slotCount; i++) {
+    if (slots[i].used && slots[i].id == id) {
+      return i;
+    }
+  }
+  for (size_t i = 0; i < slotCount; i++) {
+    if (!slots[i].used) {
+      return i;
+    }
+    if (oldest < 0 || (int32_t)(slots[i].sequence - slots[oldest].sequence) < 0) {
+      oldest = i;
+    }
+  }
+  return oldest;
+}
+
+bool lessonCacheStore(const LessonBundle& lesson, const uint8_t* bundle, size_t length) {
+  if (!lessonPartition || length > LESSON_MAX_SIZE) {
+    return false;
+  }
+  int slot = chooseSlot(lesson.id);
+  if (slot < 0) {
+    return false;
+  }
+  if (slot == openSlot) {
+    lessonCacheClose();
+  }
+  slots[slot].used = false;
+
+  size_t base = slot * LESSON_SLOT_SIZE;
+  LessonSlotHeader header = {LESSON_SLOT_MAGIC, lesson.id, lesson.hash, nextSequence, (uint32_t)length, 0};
+  header.checksum = slotChecksum(header);
+  if (esp_partition_erase_range(lessonPartition, base, LESSON_SLOT_SIZE) != ESP_OK ||
+      esp_partition_write(lessonPartition, base + LESSON_SLOT_HEADER_SIZE, bundle, length) != ESP_OK ||
+      esp_partition_write(lessonPartition, base, &header, sizeof(header)) != ESP_OK) {
+    LOG_WARN("Lesson %u: flash write failed", (unsigned)lesson.id);
+    return false;
+  }
+  slots[slot] = {true, lesson.id, lesson.hash, nextSequence++, (uint32_t)length};
+  LOG_INFO("Lesson %u (%08x) cached in slot %d, %u bytes", (unsigned)lesson.id, (unsigned)lesson.hash,
+           slot, (unsigned)length);
+  return true;
+}
+
+bool lessonCacheOpen(uint32_t id, uint32_t hash, LessonBundle& lesson) {
+  lessonCacheClose();
+  int slot = findSlot(id, hash);
+  if (slot < 0) {
+    return false;
+  }
+  const void* mapped;
+  if (esp_partition_mmap(lessonPartition, slot * LESSON_SLOT_SIZE, LESSON_SLOT_SIZE, ESP_PARTITION_MMAP_DATA,
+                         &mapped, &openHandle) != ESP_OK) {
+    LOG_WARN("Lesson %u: mmap failed", (unsigned)id);
+    return false;
+  }
+  openSlot = slot;
+  // Re-checks the version hash, so a worn or half-erased sector is never played
+  const uint8_t* bundle = static_cast<const uint8_t*>(mapped) + LESSON_SLOT_HEADER_SIZE;
+  if (!parseLessonBundle(bundle, slots[slot].length, lesson) || lesson.id != id) {
+    LOG_WARN("Lesson %u: cached copy corrupt, dropped", (unsigned)id);
+    lessonCacheClose();
+    slots[slot].used = false;
+    return false;
+  }
+  return true;
+}
+
+void lessonCacheClose() {
+  if (openSlot >= 0) {
+    esp_partition_munmap(openHandle);
+    openSlot = -1;
+  }
+}
@@ -0,0 +1,169 @@
+#include "line_display.h"
+#include "log.h"
+#include "servo_calibration.h"
+
+// ===== Command One Cell =====
+// Sends the calibrated pulse widths of line() for the dots in `mask` to
+// the driver.
+void LineDisplay::commandCell(size_t cell, uint8_t mask, unsigned long nowMs) {
+  uint16_t pulses[6];
+  for (int i = 0; i < 6; i++) {
+    pulses[i] = dotPulseUs[cell][i][(line_[cell] >> i) & 1];
+    if ((mask >> i) & 1) {
+      dotStartAt_[cell][i] = nowMs;
+      dotSettleAt_[cell][i] = nowMs + SERVO_SETTLE_MS;
+    }
+  }
+  output_.writeCell(cell, pulses, mask);
+  commanded_[cell] = (commanded_[cell] & ~mask) | (line_[cell] & mask);
+  released_ = false;   // The driver resumes every output on flush
+}
+
+// ===== Inrush Plan =====
+// Modelled supply current at `t` from every dot moving or planned to, or
+// only from those in their inrush
+unsigned long LineDisplay::currentMaAt(unsigned long t, bool inrushOnly) const {
+  unsigned long ma = 0;
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    for (int i = 0; i < 6; i++) {
+      if ((long)(t - dotStartAt_[c][i]) >= 0 && (long)(t - dotSettleAt_[c][i]) < 0) {
+        if (t - dotStartAt_[c][i] < SERVO_INRUSH_MS) {
+          ma += SERVO_INRUSH_MA;
+        } else if (!inrushOnly) {
+          ma += SERVO_MOVE_MA;
+        }
+      }
+    }
+  }
+  return ma;
+}
+
+// Next time after `t` that a dot leaves its inrush or settles
+unsigned long LineDisplay::nextDropAfter(unsigned long t) const {
+  unsigned long next = t + SERVO_INRUSH_MS;
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    for (int i = 0; i < 6; i++) {
+      unsigned long drops[2] = {dotStartAt_[c][i] + SERVO_INRUSH_MS, dotSettleAt_[c][i]};
+      for (unsigned long drop : drops) {
+        if ((long)(drop - t) > 0 && (long)(drop - next) < 0) {
+          next = drop;
+        }
+      }
+    }
+  }
+  return next;
+}
+
+// Gives each dot still to be commanded a start time, in order and never
+// earlier than the one before. Every dot's draw only falls after its
+// start, so the current at a start is the peak for the rest of the plan.
+// Past `maxDelayMs` only the inrushes are kept apart.
+void LineDisplay::plan(unsigned long nowMs, unsigned long maxDelayMs) {
+  unsigned long t = nowMs;
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    uint8_t moves = line_[c] ^ commanded_[c];
+    for (int i = 0; i < 6; i++) {
+      if (!((moves >> i) & 1)) {
+        continue;
+      }
+      for (;;) {
+        unsigned long ma = currentMaAt(t, t - nowMs >= maxDelayMs);
+        if (ma == 0 || ma + SERVO_INRUSH_MA <= SERVO_CURRENT_BUDGET_MA) {
+          break;
+        }
+        t = nextDropAfter(t);
+      }
+      dotStartAt_[c][i] = t;
+      dotSettleAt_[c][i] = t + SERVO_SETTLE_MS;
+    }
+  }
+}
+
+// Forgets the starts planned for dots of `cell` that have not started
+void LineDisplay::unplan(size_t cell, unsigned long nowMs) {
+  uint8_t waiting = line_[cell] ^ commanded_[cell];
+  for (int i = 0; i < 6; i++) {
+    if ((waiting >> i) & 1) {
+      dotStartAt_[cell][i] = dotSettleAt_[cell][i] = nowMs;
+    }
+  }
+}
+
+// Dots still travelling from an earlier line also delay this one
+void LineDisplay::updateSettledAt(unsigned long fromMs) {
+  settledAt_ = fromMs;
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    for (int i = 0; i < 6; i++) {
+      if ((long)(dotSettleAt_[c][i] - settledAt_) > 0) {
+        settledAt_ = dotSettleAt_[c][i];
+      }
+    }
+  }
+}
+
+// ===== Show =====
+void LineDisplay::show(const uint8_t line[DISPLAY_CELLS], unsigned long nowMs) {
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    unplan(c, nowMs);   // Dots of the previous line yet to start are replanned
+    line_[c] = line[c] & 0b111111;
+    uint8_t changed = line_[c] ^ commanded_[c];
+    for (int i = 0; i < 6; i++) {
+      if ((changed >> i) & 1) {
+        LOG_DEBUG("  Cell %u dot %d: %s", (unsigned)c + 1, 6 - i, ((line_[c] >> i) & 1) ? "RAISED" : "lowered");
+      }
+    }
+  }
+  plan(nowMs, SERVO_STAGGER_MAX_MS);
+  service(nowMs);
+  updateSettledAt(nowMs);
+}
+
+void LineDisplay::commandAll(const uint8_t line[DISPLAY_CELLS], unsigned long nowMs) {
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    unplan(c, nowMs);
+    line_[c] = line[c] & 0b111111;
+    commanded_[c] = ~line_[c] & 0b111111;   // Positions unknown: every dot moves
+  }
+  plan(nowMs, ~0UL >> 1);
+  service(nowMs);
+  updateSettledAt(nowMs);
+}
+
+void LineDisplay::service(unsigned long nowMs) {
+  bool commanded = false;
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    uint8_t waiting = line_[c] ^ commanded_[c];
+    uint8_t due = 0;
+    for (int i = 0; i < 6; i++) {
+      if ((waiting >> i) & 1 && (long)(nowMs - dotStartAt_[c][i]) >= 0) {
+        due |= 1 << i;
+      }
+    }
+    if (due) {
+      commandCell(c, due, nowMs);
+      commanded = true;
+    }
+  }
+  if (commanded) {
+    output_.flush();
+    updateSettledAt(settledAt_);   // A late start also settles late
+  }
+}
+
+bool LineDisplay::nextStartAt(unsigned long& startAt) const {
+  bool waiting = false;
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    for (int i = 0; i < 6; i++) {
+      if (((line_[c] ^ commanded_[c]) >> i) & 1 && (!waiting || (long)(dotStartAt_[c][i] - startAt) < 0)) {
+        startAt = dotStartAt_[c][i];
+        waiting = true;
+      }
+    }
+  }
+  return waiting;
+}
+
+void LineDisplay::release() {
+  output_.release();
+  released_ = true;
+}
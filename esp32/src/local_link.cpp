@@ -0,0 +1,407 @@
+#include <Arduino.h>
+#include <errno.h>
+#include <lwip/sockets.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/sha1.h>
+#include "local_link.h"
+#include "log.h"
+
+// ===== WebSocket Protocol =====
+const char* WS_ACCEPT_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+const char* WS_REQUEST_PATH = "/braille";
+const char* WS_AUTH_SCHEME = "Bearer ";
+const uint8_t WS_OPCODE_CONTINUATION = 0x0;
+const uint8_t WS_OPCODE_BINARY = 0x2;
+const uint8_t WS_OPCODE_CLOSE = 0x8;
+const uint8_t WS_OPCODE_PING = 0x9;
+const uint8_t WS_OPCODE_PONG = 0xA;
+const uint16_t WS_CLOSE_NORMAL = 1000;
+const uint16_t WS_CLOSE_PROTOCOL_ERROR = 1002;
+const uint16_t WS_CLOSE_UNSUPPORTED = 1003;
+const uint16_t WS_CLOSE_TOO_BIG = 1009;
+const size_t WS_KEY_MAX = 32;
+
+// ===== Socket Setup =====
+// Dead peers (laptop asleep, out of range) are found by TCP keepalive
+const int LOCAL_LINK_KEEPALIVE_IDLE_S = 10;
+const int LOCAL_LINK_KEEPALIVE_INTERVAL_S = 5;
+const int LOCAL_LINK_KEEPALIVE_COUNT = 3;
+const long LOCAL_LINK_SEND_TIMEOUT_MS = 1000;
+
+bool LocalLink::begin(uint16_t port, const char* key) {
+  if (listenFd_ >= 0) {
+    return true;
+  }
+  key_ = key;
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    LOG_WARN("Local link: socket failed (%d)", errno);
+    return false;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+    LOG_WARN("Local link: cannot listen on port %u (%d)", port, errno);
+    ::close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  listenFd_ = fd;
+  LOG_INFO("Local link listening on port %u", port);
+  return true;
+}
+
+void LocalLink::addFds(fd_set& readable, int& maxFd) const {
+  if (listenFd_ >= 0) {
+    FD_SET(listenFd_, &readable);
+    maxFd = max(maxFd, listenFd_);
+  }
+  if (clientFd_ >= 0) {
+    FD_SET(clientFd_, &readable);
+    maxFd = max(maxFd, clientFd_);
+  }
+  if (pendingFd_ >= 0) {
+    FD_SET(pendingFd_, &readable);
+    maxFd = max(maxFd, pendingFd_);
+  }
+}
+
+void LocalLink::service(unsigned long nowMs) {
+  if (listenFd_ < 0) {
+    return;
+  }
+  acceptClient(nowMs);
+  if (pendingFd_ >= 0 && nowMs - pendingAt_ > LOCAL_LINK_HANDSHAKE_TIMEOUT_MS) {
+    LOG_WARN("Local link: handshake timed out");
+    closePending();
+  }
+  readPending();
+
+  // Drain the socket; messages are dispatched as soon as they are complete
+  while (clientFd_ >= 0 && rxLength_ < LOCAL_LINK_BUFFER_SIZE) {
+    ssize_t n = recv(clientFd_, rx_ + rxLength_, LOCAL_LINK_BUFFER_SIZE - rxLength_, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+    if (n <= 0) {
+      LOG_INFO("Local link: client disconnected");
+      closeClient();
+      return;
+    }
+    rxLength_ += n;
+    if (!readFrames()) {
+      return;
+    }
+  }
+}
+
+// New connections wait in the pending slot and the current client keeps
+// running meanwhile; one that arrives while the slot is taken is refused.
+void LocalLink::acceptClient(unsigned long nowMs) {
+  int fd = accept(listenFd_, nullptr, nullptr);
+  if (fd < 0) {
+    return;
+  }
+  if (pendingFd_ >= 0) {
+    LOG_WARN("Local link: handshake in progress, refusing connection");
+    ::close(fd);
+    return;
+  }
+  int one = 1;
+  int idle = LOCAL_LINK_KEEPALIVE_IDLE_S;
+  int interval = LOCAL_LINK_KEEPALIVE_INTERVAL_S;
+  int count = LOCAL_LINK_KEEPALIVE_COUNT;
+  struct timeval sendTimeout = {LOCAL_LINK_SEND_TIMEOUT_MS / 1000, (LOCAL_LINK_SEND_TIMEOUT_MS % 1000) * 1000};
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+  setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+  pendingFd_ = fd;
+  pendingAt_ = nowMs;
+  pendingLength_ = 0;
+}
+
+void LocalLink::readPending() {
+  if (pendingFd_ < 0) {
+    return;
+  }
+  ssize_t n = recv(pendingFd_, pendingRx_ + pendingLength_, LOCAL_LINK_HANDSHAKE_MAX - pendingLength_, MSG_DONTWAIT);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return;
+  }
+  if (n <= 0) {
+    closePending();
+    return;
+  }
+  pendingLength_ += n;
+  readHandshake();
+}
+
+// ===== HTTP Upgrade =====
+// Only the request target, Authorization and Sec-WebSocket-Key matter;
+// the rest of the request is not checked. The key goes in a header, not
+// the URL, so it stays out of proxy and access logs.
+
+// Value of the first header `name` (colon included), trailing spaces
+// trimmed; nullptr if there is none
+static const char* headerValue(const char* request, const char* name, size_t& length) {
+  size_t nameLength = strlen(name);
+  for (const char* line = strstr(request, "\r\n"); line; line = strstr(line, "\r\n")) {
+    line += 2;
+    if (strncasecmp(line, name, nameLength) == 0) {
+      const char* value = line + nameLength;
+      while (*value == ' ') {
+        value++;
+      }
+      length = strcspn(value, "\r");
+      while (length > 0 && value[length - 1] == ' ') {
+        length--;
+      }
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+// Takes the same time however much of the key a wrong guess gets right
+static bool keyMatches(const char* given, size_t givenLength, const char* key) {
+  size_t keyLength = strlen(key);
+  uint8_t diff = givenLength != keyLength;
+  for (size_t i = 0; i < keyLength; i++) {
+    diff |= key[i] ^ (i < givenLength ? given[i] : 0);
+  }
+  return diff == 0;
+}
+
+void LocalLink::readHandshake() {
+  pendingRx_[pendingLength_] = '\0';
+  char* request = pendingRx_;
+  char* end = strstr(request, "\r\n\r\n");
+  if (!end) {
+    if (pendingLength_ == LOCAL_LINK_HANDSHAKE_MAX) {
+      closePending();
+    }
+    return;   // Wait for the rest of the headers
+  }
+  *end = '\0';
+
+  size_t pathLength = strlen(WS_REQUEST_PATH);
+  size_t schemeLength = strlen(WS_AUTH_SCHEME);
+  const char* target = strncmp(request, "GET ", 4) == 0 ? request + 4 : "";
+  size_t authLength = 0;
+  const char* auth = headerValue(request, "Authorization:", authLength);
+  bool authorized = strncmp(target, WS_REQUEST_PATH, pathLength) == 0 && target[pathLength] == ' ' && auth &&
+                    authLength >= schemeLength && strncasecmp(auth, WS_AUTH_SCHEME, schemeLength) == 0 &&
+                    keyMatches(auth + schemeLength, authLength - schemeLength, key_);
+
+  char wsKey[WS_KEY_MAX + 1] = "";
+  size_t wsKeyLength = 0;
+  const char* wsKeyValue = headerValue(request, "Sec-WebSocket-Key:", wsKeyLength);
+  if (wsKeyValue && wsKeyLength <= WS_KEY_MAX) {
+    memcpy(wsKey, wsKeyValue, wsKeyLength);
+    wsKey[wsKeyLength] = '\0';
+  }
+
+  if (!authorized || wsKey[0] == '\0') {
+    LOG_WARN("Local link: rejected %s request", authorized ? "malformed" : "unauthorized");
+    const char* response = authorized ? "HTTP/1.1 400 Bad Request\r\n\r\n" : "HTTP/1.1 403 Forbidden\r\n\r\n";
+    send(pendingFd_, response, strlen(response), 0);
+    closePending();
+    return;
+  }
+
+  char digestInput[WS_KEY_MAX + 37];
+  snprintf(digestInput, sizeof(digestInput), "%s%s", wsKey, WS_ACCEPT_GUID);
+  uint8_t digest[20];
+  mbedtls_sha1_ret(reinterpret_cast<const unsigned char*>(digestInput), strlen(digestInput), digest);
+  unsigned char accept[32];
+  size_t acceptLength = 0;
+  mbedtls_base64_encode(accept, sizeof(accept), &acceptLength, digest, sizeof(digest));
+
+  char response[160];
+  int responseLength = snprintf(response, sizeof(response),
+                                "HTTP/1.1 101 Switching Protocols\r\n"
+                                "Upgrade: websocket\r\n"
+                                "Connection: Upgrade\r\n"
+                                "Sec-WebSocket-Accept: %.*s\r\n\r\n",
+                                (int)acceptLength, reinterpret_cast<const char*>(accept));
+  if (send(pendingFd_, response, responseLength, 0) != responseLength) {
+    closePending();
+    return;
+  }
+
+  // The upgrade succeeded, so the pending client takes over; anything
+  // after its headers is already frame data
+  if (clientFd_ >= 0) {
+    LOG_INFO("Local link: replacing client");
+    closeClient();
+  }
+  size_t consumed = (end + 4) - request;
+  rxLength_ = pendingLength_ - consumed;
+  memcpy(rx_, pendingRx_ + consumed, rxLength_);
+  clientFd_ = pendingFd_;
+  pendingFd_ = -1;
+  pendingLength_ = 0;
+  LOG_INFO("Local link: client connected");
+  readFrames();
+}
+
+// ===== Frames =====
+// Unfragmented binary messages plus the control frames; the payload is
+// unmasked in place and handed on straight from the receive buffer.
+bool LocalLink::readFrames() {
+  size_t offset = 0;
+  while (rxLength_ - offset >= 2) {
+    uint8_t* frame = rx_ + offset;
+    size_t available = rxLength_ - offset;
+    bool fin = frame[0] & 0x80;
+    uint8_t opcode = frame[0] & 0x0F;
+    bool masked = frame[1] & 0x80;
+    uint64_t length = frame[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+      if (available < 4) {
+        break;
+      }
+      length = (uint16_t)frame[2] << 8 | frame[3];
+      header = 4;
+    } else if (length == 127) {
+      if (available < 10) {
+        break;
+      }
+      length = 0;
+      for (int i = 2; i < 10; i++) {
+        length = length << 8 | frame[i];
+      }
+      header = 10;
+    }
+    if (!masked) {
+      close(WS_CLOSE_PROTOCOL_ERROR);   // Clients must mask
+      return false;
+    }
+    header += 4;
+    if (length > LOCAL_LINK_BUFFER_SIZE - header) {
+      LOG_WARN("Local link: %u byte message too big", (unsigned)length);
+      close(WS_CLOSE_TOO_BIG);
+      return false;
+    }
+    if (available < header + length) {
+      break;   // Wait for the rest of the frame
+    }
+
+    uint8_t* data = frame + header;
+    const uint8_t* mask = data - 4;
+    for (size_t i = 0; i < length; i++) {
+      data[i] ^= mask[i & 3];
+    }
+    if (!fin || opcode == WS_OPCODE_CONTINUATION) {
+      close(WS_CLOSE_UNSUPPORTED);      // Senders keep messages in one frame
+      return false;
+    }
+    switch (opcode) {
+      case WS_OPCODE_BINARY:
+        dispatch(data, length);
+        break;
+      case WS_OPCODE_PING:
+        sendFrame(WS_OPCODE_PONG, data, length, nullptr, 0);
+        break;
+      case WS_OPCODE_PONG:
+        break;
+      case WS_OPCODE_CLOSE:
+        close(WS_CLOSE_NORMAL);
+        return false;
+      default:
+        close(WS_CLOSE_UNSUPPORTED);
+        return false;
+    }
+    if (clientFd_ < 0) {
+      return false;   // The callback's reply failed and dropped the client
+    }
+    offset += header + length;
+  }
+  memmove(rx_, rx_ + offset, rxLength_ - offset);
+  rxLength_ -= offset;
+  return true;
+}
+
+void LocalLink::dispatch(uint8_t* data, size_t length) {
+  size_t topicLength = length > 0 ? data[0] : 0;
+  if (topicLength == 0 || topicLength > LOCAL_LINK_TOPIC_MAX || topicLength + 1 > length) {
+    LOG_WARN("Local link: malformed message (%u bytes)", (unsigned)length);
+    return;
+  }
+  char topic[LOCAL_LINK_TOPIC_MAX + 1];
+  memcpy(topic, data + 1, topicLength);
+  topic[topicLength] = '\0';
+  if (callback_) {
+    callback_(topic, data + 1 + topicLength, length - 1 - topicLength);
+  }
+}
+
+bool LocalLink::publish(const char* topic, const uint8_t* payload, size_t length) {
+  size_t topicLength = strlen(topic);
+  if (!connected() || topicLength > LOCAL_LINK_TOPIC_MAX) {
+    return false;
+  }
+  uint8_t head[1 + LOCAL_LINK_TOPIC_MAX];
+  head[0] = topicLength;
+  memcpy(head + 1, topic, topicLength);
+  return sendFrame(WS_OPCODE_BINARY, head, 1 + topicLength, payload, length);
+}
+
+// Server frames are unmasked; the parts go out as one segment
+bool LocalLink::sendFrame(uint8_t opcode, const uint8_t* head, size_t headLength, const uint8_t* body,
+                          size_t bodyLength) {
+  size_t length = headLength + bodyLength;
+  uint8_t header[4] = {(uint8_t)(0x80 | opcode)};
+  size_t headerLength = 2;
+  if (length < 126) {
+    header[1] = length;
+  } else {
+    header[1] = 126;
+    header[2] = length >> 8;
+    header[3] = length;
+    headerLength = 4;
+  }
+  bool ok = send(clientFd_, header, headerLength, MSG_MORE) == (ssize_t)headerLength &&
+            send(clientFd_, head, headLength, bodyLength ? MSG_MORE : 0) == (ssize_t)headLength &&
+            (bodyLength == 0 || send(clientFd_, body, bodyLength, 0) == (ssize_t)bodyLength);
+  if (!ok) {
+    LOG_WARN("Local link: send failed (%d)", errno);
+    closeClient();
+  }
+  return ok;
+}
+
+void LocalLink::close(uint16_t code) {
+  uint8_t payload[2] = {(uint8_t)(code >> 8), (uint8_t)code};
+  sendFrame(WS_OPCODE_CLOSE, payload, sizeof(payload), nullptr, 0);
+  closeClient();
+}
+
+void LocalLink::disconnect() {
+  closeClient();
+  closePending();
+}
+
+void LocalLink::closeClient() {
+  if (clientFd_ >= 0) {
+    ::close(clientFd_);
+    clientFd_ = -1;
+  }
+  rxLength_ = 0;
+}
+
+void LocalLink::closePending() {
+  if (pendingFd_ >= 0) {
+    ::close(pendingFd_);
+    pendingFd_ = -1;
+  }
+  pendingLength_ = 0;
+}
@@ -0,0 +1,97 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include "log.h"
+
+// ===== Log Ring Buffer =====
+// Multiple producers (network task, actuation task, WiFi event task) append
+// under a spinlock; the drain task is the only reader.
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0,
+              "LOG_BUFFER_SIZE must be a power of two");
+
+static char logBuffer[LOG_BUFFER_SIZE];
+static size_t logHead = 0;      // Free-running write counter
+static size_t logTail = 0;      // Free-running read counter
+static uint32_t logDropped = 0; // Messages lost because the buffer was full
+static portMUX_TYPE logLock = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t LOG_TASK_STACK = 3072;
+static const UBaseType_t LOG_TASK_PRIORITY = 1;   // Lowest above idle
+static const BaseType_t LOG_TASK_CORE = 0;        // Keep core 1 free for actuation
+static TaskHandle_t logTask = nullptr;
+
+static bool logAppend(const char* data, size_t len) {
+  bool stored = false;
+  portENTER_CRITICAL(&logLock);
+  if (LOG_BUFFER_SIZE - (logHead - logTail) >= len) {
+    for (size_t i = 0; i < len; i++) {
+      logBuffer[(logHead + i) & (LOG_BUFFER_SIZE - 1)] = data[i];
+    }
+    logHead += len;
+    stored = true;
+  } else {
+    logDropped++;
+  }
+  portEXIT_CRITICAL(&logLock);
+  return stored;
+}
+
+static size_t logRead(uint8_t* out, size_t max) {
+  portENTER_CRITICAL(&logLock);
+  size_t n = logHead - logTail;
+  if (n > max) {
+    n = max;
+  }
+  for (size_t i = 0; i < n; i++) {
+    out[i] = logBuffer[(logTail + i) & (LOG_BUFFER_SIZE - 1)];
+  }
+  logTail += n;
+  portEXIT_CRITICAL(&logLock);
+  return n;
+}
+
+void logWrite(char level, const char* fmt, ...) {
+  char line[LOG_LINE_MAX];
+  int prefix = snprintf(line, sizeof(line), "[%c] ", level);
+
+  va_list args;
+  va_start(args, fmt);
+  int body = vsnprintf(line + prefix, sizeof(line) - prefix - 1, fmt, args);
+  va_end(args);
+
+  size_t len = prefix + (body < 0 ? 0 : body);
+  if (len > sizeof(line) - 2) {
+    len = sizeof(line) - 2;   // Truncated; keep room for the newline
+  }
+  line[len++] = '\n';
+  logAppend(line, len);
+  if (logTask) {
+    xTaskNotifyGive(logTask);   // Also wakes it to report drops
+  }
+}
+
+// ===== Log Drain Task =====
+static void logDrainTask(void* param) {
+  uint8_t chunk[64];
+  for (;;) {
+    size_t n = logRead(chunk, sizeof(chunk));
+    if (n > 0) {
+      Serial.write(chunk, n);
+      continue;
+    }
+
+    portENTER_CRITICAL(&logLock);
+    uint32_t dropped = logDropped;
+    logDropped = 0;
+    portEXIT_CRITICAL(&logLock);
+    if (dropped > 0) {
+      Serial.printf("[W] %u log messages dropped\n", (unsigned)dropped);
+    }
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+void logBegin() {
+  xTaskCreatePinnedToCore(logDrainTask, "log", LOG_TASK_STACK, nullptr,
+                          LOG_TASK_PRIORITY, &logTask, LOG_TASK_CORE);
+}
@@ -1,7 +1,33 @@
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
 #include <PubSubClient.h>
-#include <ESP32Servo.h>
+#include <Preferences.h>
+#include <atomic>
+#include <esp_sntp.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <esp_vfs_eventfd.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "braille_table.h"
+#include "cell_frame.h"
+#include "cell_output.h"
+#include "cell_queue.h"
+#include "firmware.h"
+#include "grade2.h"
+#include "heap_guard.h"
+#include "latency.h"
+#include "lesson.h"
+#include "lesson_cache.h"
+#include "line_display.h"
+#include "line_player.h"
+#include "local_link.h"
+#include "log.h"
+#include "pace.h"
+#include "quiz.h"
+#include "servo_calibration.h"
+#include "telemetry.h"
+#include "tls_client.h"
 
 // ===== WiFi Configuration =====
 const char* ssid = "suito";           // Replace with your WiFi SSID
@@ -12,287 +38,1812 @@ const char* mqtt_server = "038f74955fe741d3b52eeabac9673729.s1.eu.hivemq.cloud";
 const int mqtt_port = 8883;                     // MQTTS port (TLS)
 const char* mqtt_user = "sudip";       // Replace with your MQTT username (if required)
 const char* mqtt_password = "12345678aA";   // Replace with your MQTT password (if required)
+const char* mqtt_group = "classroom";   // Default group, changed at runtime via braille/<id>/group
+
+// ===== MQTT Topics =====
+// Every device listens on three scopes, each with the same message kinds:
+//   broadcast  braille, braille/<kind>              every device
+//   group      braille/group/<group>/<kind>         one classroom
+//   device     braille/<device id>/<kind>           one unit (MAC based)
+// Kinds: text (on broadcast: plain "braille"), grade2, cells, calibrate,
+// latency, lesson, play, quiz; plus group and pace on the device scope.
+// calibrate and latency are not accepted on the group scope.
 const char* mqtt_topic = "braille";     // MQTT topic to subscribe to
+const char* mqtt_topic_grade2 = "braille/grade2";  // Same, but text is shown contracted
+const char* mqtt_topic_cells = "braille/cells";    // Binary cell frames (cell_frame.h)
+const char* mqtt_topic_calibrate = "braille/calibrate";  // Servo trim commands (servo_calibration.h)
+const char* mqtt_topic_latency = "braille/latency";      // "reset", or anything else to request a report
+const char* mqtt_topic_latency_report = "braille/latency/report";  // + "/<device id>", JSON histograms (latency.h)
+const char* mqtt_topic_lesson = "braille/lesson";        // Lesson bundles to cache (lesson.h)
+const char* mqtt_topic_play = "braille/play";            // Play a cached lesson
+const char* mqtt_topic_lesson_status = "braille/lesson/status";  // + "/<device id>"
+const char* mqtt_topic_quiz = "braille/quiz";            // Quiz bundles (quiz.h)
+const char* mqtt_topic_quiz_results = "braille/quiz/results";    // + "/<device id>", batched answers
+const char* mqtt_topic_group_root = "braille/group";
+const char* MQTT_KIND_TEXT = "text";
+const char* MQTT_KIND_GRADE2 = "grade2";
+const char* MQTT_KIND_CELLS = "cells";
+const char* MQTT_KIND_CALIBRATE = "calibrate";
+const char* MQTT_KIND_LATENCY = "latency";
+const char* MQTT_KIND_GROUP = "group";
+const char* MQTT_KIND_LESSON = "lesson";
+const char* MQTT_KIND_PLAY = "play";
+const char* MQTT_KIND_PACE = "pace";
+const char* MQTT_KIND_QUIZ = "quiz";
+const size_t MQTT_GROUP_MAX = 32;
+
+char deviceTopicPrefix[24] = "";           // "braille/<device id>/"
+char groupTopicPrefix[24 + MQTT_GROUP_MAX] = "";  // "braille/group/<group>/"
+char latencyReportTopic[48] = "";
+char lessonStatusTopic[48] = "";
+char quizResultsTopic[48] = "";
+char mqttGroup[MQTT_GROUP_MAX + 1] = "";
+Preferences mqttPrefs;
+const char* mqtt_topic_telemetry = "braille/telemetry";  // + "/<device id>", binary (telemetry.h)
+const char* mqtt_topic_ack = "braille/ack";              // + "/<device id>", frame acks (cell_frame.h)
+const char* mqtt_topic_local = "braille/local";          // + "/<device id>", retained "<ip> <port> <group>"
+
+// ===== Local Link Configuration =====
+// Backends on the same LAN connect straight to the device over a
+// WebSocket (local_link.h) and skip the cloud broker; the broker stays the
+// fallback. They find the device through its retained announcement on
+// mqtt_topic_local. While a client is connected, acks and lesson status
+// go back over the link too. The link only takes the low-latency kinds
+// (localLinkCallback); calibration, lesson uploads, group changes and
+// latency commands stay on the broker.
+const bool LOCAL_LINK_ENABLED = true;
+const char* local_link_key = "12345678";   // Replace; must match the backend's local_link_key
+
+LocalLink localLink;
+char localAnnounceTopic[48] = "";
 
-// ===== TLS/SSL Certificate (Optional - for server verification) =====
-// If your broker uses a self-signed certificate, add it here
-// For testing, you can skip certificate verification (insecure)
+// ===== TLS/SSL Certificate (server verification) =====
+// Root CA the broker certificate must chain to. HiveMQ Cloud uses Let's
+// Encrypt, i.e. ISRG Root X1 (valid until 2035). Replace it if your broker
+// uses a different or self-signed CA.
 const char* ca_cert = R"EOF(
 -----BEGIN CERTIFICATE-----
-(Add your CA certificate here for secure connection)
+MIIFazCCA1OgAwIBAgIRAIIQz7DSQONZRGPgu2OCiwAwDQYJKoZIhvcNAQELBQAw
+TzELMAkGA1UEBhMCVVMxKTAnBgNVBAoTIEludGVybmV0IFNlY3VyaXR5IFJlc2Vh
+cmNoIEdyb3VwMRUwEwYDVQQDEwxJU1JHIFJvb3QgWDEwHhcNMTUwNjA0MTEwNDM4
+WhcNMzUwNjA0MTEwNDM4WjBPMQswCQYDVQQGEwJVUzEpMCcGA1UEChMgSW50ZXJu
+ZXQgU2VjdXJpdHkgUmVzZWFyY2ggR3JvdXAxFTATBgNVBAMTDElTUkcgUm9vdCBY
+MTCCAiIwDQYJKoZIhvcNAQEBBQADggIPADCCAgoCggIBAK3oJHP0FDfzm54rVygc
+h77ct984kIxuPOZXoHj3dcKi/vVqbvYATyjb3miGbESTtrFj/RQSa78f0uoxmyF+
+0TM8ukj13Xnfs7j/EvEhmkvBioZxaUpmZmyPfjxwv60pIgbz5MDmgK7iS4+3mX6U
+A5/TR5d8mUgjU+g4rk8Kb4Mu0UlXjIB0ttov0DiNewNwIRt18jA8+o+u3dpjq+sW
+T8KOEUt+zwvo/7V3LvSye0rgTBIlDHCNAymg4VMk7BPZ7hm/ELNKjD+Jo2FR3qyH
+B5T0Y3HsLuJvW5iB4YlcNHlsdu87kGJ55tukmi8mxdAQ4Q7e2RCOFvu396j3x+UC
+B5iPNgiV5+I3lg02dZ77DnKxHZu8A/lJBdiB3QW0KtZB6awBdpUKD9jf1b0SHzUv
+KBds0pjBqAlkd25HN7rOrFleaJ1/ctaJxQZBKT5ZPt0m9STJEadao0xAH0ahmbWn
+OlFuhjuefXKnEgV4We0+UXgVCwOPjdAvBbI+e0ocS3MFEvzG6uBQE3xDk3SzynTn
+jh8BCNAw1FtxNrQHusEwMFxIt4I7mKZ9YIqioymCzLq9gwQbooMDQaHWBfEbwrbw
+qHyGO0aoSCqI3Haadr8faqU9GY/rOPNk3sgrDQoo//fb4hVC1CLQJ13hef4Y53CI
+rU7m2Ys6xt0nUW7/vGT1M0NPAgMBAAGjQjBAMA4GA1UdDwEB/wQEAwIBBjAPBgNV
+HRMBAf8EBTADAQH/MB0GA1UdDgQWBBR5tFnme7bl5AFzgAiIyBpY9umbbjANBgkq
+hkiG9w0BAQsFAAOCAgEAVR9YqbyyqFDQDLHYGmkgJykIrGF1XIpu+ILlaS/V9lZL
+ubhzEFnTIZd+50xx+7LSYK05qAvqFyFWhfFQDlnrzuBZ6brJFe+GnY+EgPbk6ZGQ
+3BebYhtF8GaV0nxvwuo77x/Py9auJ/GpsMiu/X1+mvoiBOv/2X/qkSsisRcOj/KK
+NFtY2PwByVS5uCbMiogziUwthDyC3+6WVwW6LLv3xLfHTjuCvjHIInNzktHCgKQ5
+ORAzI4JMPJ+GslWYHb4phowim57iaztXOoJwTdwJx4nLCgdNbOhdjsnvzqvHu7Ur
+TkXWStAmzOVyyghqpZXjFaH3pO3JLF+l+/+sKAIuvtd7u+Nxe5AW0wdeRlN8NwdC
+jNPElpzVmbUq4JUagEiuTDkHzsxHpFKVK7q4+63SM1N95R1NbdWhscdCb+ZAJzVc
+oyi3B43njTOQ5yOf+1CceWxG1bQVs5ZufpsMljq4Ui0/1lvh+wjChP4kqKOJ2qxq
+4RgqsahDYVvTH9w7jXbyLeiNdd8XM2w9U/t7y0Ff/9yi0GE44Za4rF2LN9d11TPA
+mRGunUHBcnWEvgJBQl9nJEiU0Zsnvgc/ubhPgXRR4Xq37Z0j4r7g1SgEEzwxA57d
+emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=
 -----END CERTIFICATE-----
 )EOF";
 
-// ===== Servo Configuration =====
-// 6 servos representing 6 Braille dots
-// Dot numbering (standard Braille):
-//   1 • • 4
-//   2 • • 5
-//   3 • • 6
-const int SERVO_PINS[6] = {18, 19, 21, 22, 23, 25};  // GPIO pins for servos 1-6
-const int RAISED_ANGLE = 90;    // Servo angle for raised dot (active)
-const int LOWERED_ANGLE = 0;    // Servo angle for lowered dot (inactive)
+// ===== Display Line State =====
+// The display shows DISPLAY_CELLS cells at once (cell_output.h), tracked
+// by LineDisplay (line_display.h). Owned by the actuation task.
+LineDisplay display(displayOutput());
 
-Servo servos[6];
+// ===== Idle Power Management =====
+// Once a line has settled the servo pulses are stopped (CellOutput::release)
+// until the next command, so idle servos neither hum nor draw holding
+// current. WiFi uses DTIM modem sleep: the radio wakes for each beacon,
+// which the MQTT keepalive and incoming messages are delivered on.
+const bool SERVO_IDLE_RELEASE = true;        // false if dots get pushed down while released
+const unsigned long SERVO_RELEASE_DELAY_MS = 300;   // After settling, before release
 
-// ===== WiFi and MQTT Clients =====
-WiFiClientSecure espClient;
-PubSubClient mqtt_client(espClient);
+// ===== Fast Boot =====
+// The line on display is mirrored in RTC memory. After a warm reset
+// (brownout, watchdog, crash) the servos are re-commanded to it straight
+// away instead of sweeping to blank, and the connect flash is skipped, so
+// a student's current cell survives the reset.
+const uint32_t DISPLAY_STATE_MAGIC = 0xD15B1A7E;
+
+struct DisplayState {
+  uint32_t magic;
+  uint8_t line[DISPLAY_CELLS];
+  uint32_t checksum;      // FNV-1a over the fields above
+};
+
+RTC_NOINIT_ATTR DisplayState rtcDisplayState;
+bool warmBoot = false;    // Set in setup() when rtcDisplayState survived a reset
+
+// ===== Cell Playback Configuration =====
+// Incoming text is translated into cells and queued. Playback fills the
+// line with the next cells (wrapping at word boundaries) and holds it for
+// the sum of their dwells (CELL_DWELL_MS each by default) after the dots
+// settle (line_player.h). The last line stays up until new text arrives.
+#ifndef CELL_DWELL_MS
+#define CELL_DWELL_MS 600UL
+#endif
+const size_t CELL_QUEUE_CAPACITY = 256;     // A full-queue frame must fit MQTT_MAX_PACKET_SIZE
+
+CellQueue<CELL_QUEUE_CAPACITY> cellQueue;
+LinePlayer<CELL_QUEUE_CAPACITY> linePlayer(display, cellQueue, CELL_DWELL_MS);   // Actuation task
+
+// Binary frames carry a sequence number so redeliveries and losses show up.
+// The position is mirrored in RTC memory so frames the broker redelivers
+// after a warm reset are still recognised as duplicates.
+const uint32_t FRAME_SEQUENCE_MAGIC = 0x5E0F7A3E;
+const size_t FRAME_SCOPES = 3;
+
+struct FrameSequenceState {
+  uint32_t magic;
+  uint16_t last[FRAME_SCOPES];   // Last accepted sequence per scope
+  uint16_t started;              // Bit per scope
+  uint32_t checksum;             // FNV-1a over the fields above
+};
+
+RTC_NOINIT_ATTR FrameSequenceState rtcFrameSequence;
+FrameSequence frameSequences[FRAME_SCOPES];   // Per CELL_ACK_SCOPE_*
+uint32_t framesDuplicate = 0;
+uint32_t framesMissed = 0;
+
+// Highest frame shown per scope, handed from the actuation task to the
+// network task for publishing; frames shown in between collapse into one ack.
+const uint32_t DISPLAY_ACK_PENDING = 1UL << 16;   // | sequence
+std::atomic<uint32_t> displayAckPending[FRAME_SCOPES] = {};
+uint32_t displayAckSent[FRAME_SCOPES] = {};   // Last cumulative ack published, network task only
+char ackTopic[48] = "";
+
+// ===== Lesson Playback =====
+// A play command walks a cached lesson (lesson_cache.h) step by step,
+// pushing each step's cells straight from flash while the queue has room.
+// This keeps going with WiFi or the broker down. If the queue is full,
+// the actuation task wakes the network task once it has made room.
+struct LessonPlayback {
+  bool active;
+  LessonBundle lesson;
+  size_t offset;          // Next step in lesson.steps
+  uint16_t remaining;     // Steps left to queue
+};
+
+LessonPlayback lessonPlayback = {};
+LessonPlay lessonPlayPending = {};   // Play that missed the cache, resumed when its bundle arrives
+bool lessonPlayPendingValid = false;
+std::atomic<bool> queueRoomPending{false};   // Also for quiz prompts
+
+// ===== Clock Sync =====
+// Devices keep UTC through SNTP so a timed frame (cell_frame.h) raises its
+// dots at the same moment on every unit of a classroom, however late each
+// copy arrives. The crystal drifts up to ~20 ppm, so the clock is polled
+// every few minutes instead of hourly. Until the first sync, and for
+// implausible times, timed frames are shown on arrival.
+const char* ntp_server = "pool.ntp.org";   // A server on the LAN syncs tighter
+const uint32_t SNTP_SYNC_INTERVAL_MS = 5 * 60 * 1000;
+const int64_t TIMED_FRAME_MAX_LEAD_MS = 60000;   // Further ahead, one of the clocks is wrong
+
+std::atomic<bool> clockSynced{false};   // Set from the lwIP task
+uint32_t framesLate = 0;
+
+// ===== Reading Pace =====
+// The actuation task shows queued cells at the learner's pace (pace.h),
+// so network jitter never reaches the reader as long as the queue is
+// ahead. Each deadline is armed on a one-shot esp_timer, which wakes the
+// task on the exact ms instead of the next FreeRTOS tick. The pace and
+// the learner's nudged speed are kept in NVS, so offline lesson playback
+// uses them too.
+PaceConfig paceConfig = PACE_DEFAULT;   // Network task
+Preferences pacePrefs;
+// Handed to the actuation task one word each
+std::atomic<uint32_t> paceTiming{0};      // dwell << 16 | gap
+std::atomic<uint16_t> paceSpeed{100};     // flags << 8 | speed percent
+esp_timer_handle_t actuationTimer = nullptr;
+
+// ===== Quiz and Answer Keys =====
+// A quiz (quiz.h) runs on the device: each prompt is queued like any other
+// cells, the learner writes the answer on the dot keys, and the answer is
+// checked against the bundle and the next prompt queued at once. A wrong
+// answer first shows the expected cell for QUIZ_FEEDBACK_DWELL_MS.
+// Results go upstream in batches of QUIZ_RESULT_BATCH, at the end of the
+// quiz, or QUIZ_RESULT_LINGER_MS after the oldest unsent one.
+//
+// Keys are active low on the internal pull-ups. An ISR on each edge takes
+// the first edge at once and ignores the bounces for QUIZ_DEBOUNCE_MS;
+// the network task then samples the pin again, in case the key was
+// released while the ISR was ignoring it.
+const bool QUIZ_KEYS_ENABLED = true;
+
+struct QuizKeyPin {
+  uint8_t pin;
+  uint8_t key;   // Cell bit of its dot, or QUIZ_KEY_NEXT
+};
+
+const QuizKeyPin QUIZ_KEY_PINS[] = {
+  {32, 1 << 5}, {33, 1 << 4}, {26, 1 << 3},   // Dots 1-3
+  {27, 1 << 2}, {14, 1 << 1}, {13, 1 << 0},   // Dots 4-6
+  {4, QUIZ_KEY_NEXT},
+};
+const size_t QUIZ_KEY_COUNT = sizeof(QUIZ_KEY_PINS) / sizeof(QUIZ_KEY_PINS[0]);
+const unsigned long QUIZ_DEBOUNCE_MS = 25;
+const uint16_t QUIZ_FEEDBACK_DWELL_MS = 1500;
+const uint8_t QUIZ_RESULT_BATCH = 8;
+const uint8_t QUIZ_RESULTS_MAX = 32;      // Held while offline; later answers are dropped
+const unsigned long QUIZ_RESULT_LINGER_MS = 30000;
 
-// ===== Braille Pattern Mapping (6-dot) =====
-// Each letter A-Z mapped to 6-bit pattern (bit 0 = dot 1, bit 5 = dot 6)
-// 1 = raised (active), 0 = lowered (inactive)
-const uint8_t braillePatterns[26] = {
-  0b100000,  // A: dot 1
-  0b110000,  // B: dots 1,2
-  0b100100,  // C: dots 1,4
-  0b100110,  // D: dots 1,4,5
-  0b100010,  // E: dots 1,5
-  0b110100,  // F: dots 1,2,4
-  0b110110,  // G: dots 1,2,4,5
-  0b110010,  // H: dots 1,2,5
-  0b010100,  // I: dots 2,4
-  0b010110,  // J: dots 2,4,5
-  0b101000,  // K: dots 1,3
-  0b111000,  // L: dots 1,2,3
-  0b101100,  // M: dots 1,3,4
-  0b101110,  // N: dots 1,3,4,5
-  0b101010,  // O: dots 1,3,5
-  0b111100,  // P: dots 1,2,3,4
-  0b111110,  // Q: dots 1,2,3,4,5
-  0b111010,  // R: dots 1,2,3,5
-  0b011100,  // S: dots 2,3,4
-  0b011110,  // T: dots 2,3,4,5
-  0b101001,  // U: dots 1,3,6
-  0b111001,  // V: dots 1,2,3,6
-  0b010111,  // W: dots 2,4,5,6
-  0b101101,  // X: dots 1,3,4,6
-  0b101111,  // Y: dots 1,3,4,5,6
-  0b101011   // Z: dots 1,3,5,6
+struct QuizRun {
+  bool active;
+  bool promptPending;       // The prompt waits for room in the queue
+  QuizBundle quiz;          // Points into quizBuffer
+  size_t offset;            // Next item in quiz.items
+  uint16_t index;           // Current item
+  QuizItem item;
+  unsigned long promptAt;   // When the prompt is due on the display
 };
 
+uint8_t quizBuffer[QUIZ_MAX_SIZE];   // Network task
+QuizRun quizRun = {};
+QuizKeys quizKeys;
+QuizResult quizResults[QUIZ_RESULTS_MAX];
+uint8_t quizResultCount = 0;
+unsigned long quizResultsSince = 0;    // When the oldest unsent result came in
+bool quizResultsFinished = false;      // The unsent batch ends the quiz
+// Written by the key ISR
+std::atomic<uint32_t> quizKeysDown{0};
+std::atomic<uint32_t> quizKeysPressed{0};    // Went down since the network task looked
+std::atomic<uint32_t> quizKeysResample{0};   // Bit per QUIZ_KEY_PINS index
+volatile unsigned long quizKeyEdgeAt[QUIZ_KEY_COUNT] = {};
+
+// Lessons publish upper-case letters and expect the bare letter cell, so
+// the capital sign is only shown when enabled here.
+const bool SHOW_CAPITAL_SIGNS = false;
+
+// ===== Task Configuration =====
+// Networking (WiFi, MQTT, TLS) runs on core 0 next to the WiFi/lwIP stack;
+// servo actuation runs on core 1 so a slow handshake or reconnect never
+// stalls the display. The two tasks only share cellQueue (lock-free SPSC)
+// and a few atomic flags.
+//
+// Neither task polls. The network task sleeps in select() on the MQTT
+// socket and an eventfd that other tasks write to (wakeNetworkTask), the
+// actuation task on its task notification (wakeActuationTask) until the
+// next line or idle deadline. A message is handled as soon as it arrives.
+const BaseType_t NETWORK_TASK_CORE = 0;
+const BaseType_t ACTUATION_TASK_CORE = 1;
+const uint32_t NETWORK_TASK_STACK = 8192;     // TLS handshake needs a deep stack
+const uint32_t ACTUATION_TASK_STACK = 4096;
+const UBaseType_t NETWORK_TASK_PRIORITY = 1;
+const UBaseType_t ACTUATION_TASK_PRIORITY = 2;  // Above the network task so pacing stays steady
+const unsigned long NETWORK_MAX_WAIT_MS = 1000;  // Upper bound, covers keepalive and WiFi timeouts
+
+TaskHandle_t networkTaskHandle = nullptr;
+TaskHandle_t actuationTaskHandle = nullptr;
+int networkWakeFd = -1;   // eventfd, written to wake the network task
+std::atomic<bool> connectFlashPending{false};  // Set by network task on MQTT connect
+std::atomic<bool> calibrationChanged{false};   // Re-command every dot with new pulses
+
+// ===== Telemetry Configuration =====
+// Counters are only written by the network task, except the actuation
+// loop maximum, which the network task takes and clears on each report.
+const unsigned long TELEMETRY_INTERVAL_MS = 30000;
+
+char deviceId[13] = "";                   // Station MAC as hex, set in setup()
+char telemetryTopic[48] = "";
+unsigned long telemetryLastAt = 0;
+uint16_t messagesProcessed = 0;           // Since the last report
+uint16_t wifiReconnects = 0;              // Since boot, not counting the first connect
+uint16_t mqttReconnects = 0;
+bool wifiEverConnected = false;
+bool mqttEverConnected = false;
+uint32_t networkLoopMaxUs = 0;            // Longest iteration since the last report
+std::atomic<uint32_t> actuationLoopMaxUs{0};
+
+// ===== WiFi Fast Reconnect Configuration =====
+// The last good BSSID/channel and IP lease are cached in RTC memory (survives
+// warm resets and brownouts) and NVS (survives power cycles). Reconnects join
+// the cached AP directly, skipping the scan, and reuse the lease to skip DHCP.
+// Association is driven by WiFi events rather than status polling.
+const bool WIFI_REUSE_IP_LEASE = true;                   // Static IP from the cached lease
+const unsigned long WIFI_FAST_CONNECT_TIMEOUT_MS = 3000;  // Then fall back to scan + DHCP
+const unsigned long WIFI_CONNECT_TIMEOUT_MS = 20000;
+const uint32_t WIFI_CACHE_MAGIC = 0xB7A1E5C4;
+
+struct WiFiCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t checksum;      // FNV-1a over the fields above
+};
+
+enum WiFiLinkState {
+  WIFI_STATE_CONNECTING,  // WiFi.begin issued, waiting for GOT_IP
+  WIFI_STATE_CONNECTED
+};
+
+RTC_NOINIT_ATTR WiFiCache rtcWiFiCache;   // Not cleared by software/brownout resets
+WiFiCache wifiCache = {};                 // Working copy, valid when magic matches
+Preferences wifiPrefs;
+
+WiFiLinkState wifiState = WIFI_STATE_CONNECTING;
+bool wifiFastAttempt = false;
+unsigned long wifiAttemptStartedAt = 0;
+std::atomic<bool> wifiGotIpEvent{false};  // Set from the WiFi event task
+std::atomic<bool> wifiLostEvent{false};
+
+// ===== MQTT Session Configuration =====
+// The client ID is derived from the MAC and the session is persistent
+// (clean session off), so the broker keeps our QoS 1 subscriptions and
+// queues messages while we are offline; they are delivered on reconnect.
+// Redeliveries of cell frames are dropped by their sequence number.
+const bool MQTT_CLEAN_SESSION = false;
+const uint8_t MQTT_CONTENT_QOS = 1;    // Text, cell frames, calibration
+char mqttClientId[32] = "";
+
+// ===== MQTT Reconnect Configuration =====
+// Failed connects back off exponentially with random jitter so the whole
+// fleet doesn't reconnect in lockstep after a broker blip.
+const unsigned long MQTT_BACKOFF_MIN_MS = 500;
+const unsigned long MQTT_BACKOFF_MAX_MS = 60000;
+const uint16_t MQTT_CONNECT_TIMEOUT_S = 10;   // Per attempt: TLS handshake and CONNACK wait
+
+enum MqttConnState {
+  MQTT_STATE_BACKOFF,     // Disconnected, next attempt at mqttNextAttemptAt
+  MQTT_STATE_CONNECTED
+};
+
+MqttConnState mqttState = MQTT_STATE_BACKOFF;   // First attempt runs immediately
+unsigned long mqttBackoffMs = MQTT_BACKOFF_MIN_MS;
+unsigned long mqttNextAttemptAt = 0;
+
+// ===== WiFi and MQTT Clients =====
+TlsClient espClient;          // Verifies ca_cert, resumes sessions across reconnects
+// PubSubClient allocates its packet buffer once, in the constructor, from
+// MQTT_MAX_PACKET_SIZE (platformio.ini). It must fit the longest topic plus
+// a frame that fills the whole cell queue or a whole lesson bundle, or the
+// packet is dropped.
+const size_t MQTT_PACKET_OVERHEAD = 5 + 2;   // Fixed header + topic length
+static_assert(MQTT_MAX_PACKET_SIZE >= MQTT_PACKET_OVERHEAD + sizeof(groupTopicPrefix) + sizeof("cells") +
+                                          CELL_FRAME_HEADER_SIZE + CELL_FRAME_TIME_SIZE +
+                                          cellFramePackedSize(CELL_QUEUE_CAPACITY),
+              "MQTT_MAX_PACKET_SIZE too small for a full-queue cell frame");
+static_assert(MQTT_MAX_PACKET_SIZE >= MQTT_PACKET_OVERHEAD + sizeof(groupTopicPrefix) + sizeof("lesson") +
+                                          LESSON_MAX_SIZE,
+              "MQTT_MAX_PACKET_SIZE too small for a lesson bundle");
+PubSubClient mqtt_client(espClient);
+
 // ===== Function Prototypes =====
 void setupWiFi();
-void reconnectMQTT();
+void serviceWiFi();
+void beginWiFi(bool useCache);
+void onWiFiConnected();
+void WiFiEvent(WiFiEvent_t event);
+bool reconnectMQTT();
+void serviceMQTT();
+void scheduleMQTTRetry();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
-void updateBrailleServos(uint8_t pattern);
-void setAllServosLowered();
+void handleCellFrame(const byte* payload, unsigned int length, uint8_t scope, uint32_t receivedUs);
+void startClockSync();
+void onClockSynced(struct timeval* tv);
+bool localShowTime(uint64_t showAtUtcMs, uint32_t& showAtMs);
+bool parseTopic(const char* topic, uint8_t& scope, const char*& kind);
+void buildGroupTopic();
+void handleGroupCommand(const byte* payload, unsigned int length);
+void loadPace();
+void applyPace(uint8_t speedPercent);
+void handlePaceCommand(const byte* payload, unsigned int length);
+void saveFrameSequences();
+void handleLessonBundle(byte* payload, unsigned int length);
+void handleLessonPlay(const byte* payload, unsigned int length);
+bool startLessonPlayback(const LessonPlay& play);
+void serviceLessonPlayback();
+void publishLessonStatus(LessonStatus status, uint32_t id, uint32_t hash);
+void handleQuizBundle(const byte* payload, unsigned int length);
+void showQuizPrompt(unsigned long promptAt);
+void answerQuizItem(uint8_t chord, bool skipped);
+void serviceQuiz();
+bool publishQuizResults();
+long quizWaitMs();
+void onQuizKeyEdge(void* arg);
+void handleLatencyCommand(const byte* payload, unsigned int length);
+void serviceSerialCommands();
+void serviceTelemetry();
+void serviceAcks();
+void publishCellAck(uint8_t scope, uint16_t sequence, uint8_t flags);
+bool publishUpstream(const char* topic, const uint8_t* payload, size_t length);
+void announceLocalLink();
+void localLinkCallback(char* topic, byte* payload, unsigned int length);
+void playNextLine();
+void networkTask(void* param);
+void actuationTask(void* param);
+void wakeNetworkTask();
+void wakeActuationTask();
+void waitForNetworkEvent();
+long actuationWaitMs();
+TickType_t armActuationTimer();
+void onActuationTimer(void* arg);
+void initDisplay();
+void serviceIdleRelease();
+void saveDisplayState();
+uint32_t fnv1a(const void* data, size_t length);
 
+#ifndef PIO_UNIT_TESTING
 void setup() {
-  Serial.begin(115200);
-  delay(1000);
-  Serial.println("\n=== ESP32 Braille Display System ===");
+  firmwareSetup(true);
+}
+
+#endif
 
-  // Initialize servos
-  ESP32PWM::allocateTimer(0);
-  ESP32PWM::allocateTimer(1);
-  ESP32PWM::allocateTimer(2);
-  ESP32PWM::allocateTimer(3);
+void firmwareSetup(bool startNetwork) {
+  // No startup delays: log output is buffered until the drain task runs
+  Serial.begin(115200);
+  logBegin();
+  LOG_INFO("=== ESP32 Braille Display System ===");
+  
+  esp_reset_reason_t reason = esp_reset_reason();
+  warmBoot = reason != ESP_RST_POWERON && rtcDisplayState.magic == DISPLAY_STATE_MAGIC &&
+             rtcDisplayState.checksum == fnv1a(&rtcDisplayState, offsetof(DisplayState, checksum));
+  LOG_INFO("Reset reason %d, %s boot", (int)reason, warmBoot ? "warm" : "cold");
+  if (reason != ESP_RST_POWERON && rtcFrameSequence.magic == FRAME_SEQUENCE_MAGIC &&
+      rtcFrameSequence.checksum == fnv1a(&rtcFrameSequence, offsetof(FrameSequenceState, checksum))) {
+    for (size_t scope = 0; scope < FRAME_SCOPES; scope++) {
+      if ((rtcFrameSequence.started >> scope) & 1) {
+        frameSequences[scope].restore(rtcFrameSequence.last[scope]);
+      }
+    }
+  }
   
+  uint64_t mac = ESP.getEfuseMac();
   for (int i = 0; i < 6; i++) {
-    servos[i].setPeriodHertz(50);
-    servos[i].attach(SERVO_PINS[i], 500, 2400);
-    // Servos 1-3: 0° lowered, Servos 4-6: 90° lowered (opposite rotation)
-    int initAngle = (i < 3) ? 0 : 90;
-    servos[i].write(initAngle);
+    snprintf(deviceId + i * 2, 3, "%02x", (unsigned)(mac >> (8 * i)) & 0xFF);
   }
-  Serial.println("✓ Servos initialized");
-  delay(500);
-
-  // Connect to WiFi
-  setupWiFi();
+  snprintf(telemetryTopic, sizeof(telemetryTopic), "%s/%s", mqtt_topic_telemetry, deviceId);
+  snprintf(ackTopic, sizeof(ackTopic), "%s/%s", mqtt_topic_ack, deviceId);
+  snprintf(mqttClientId, sizeof(mqttClientId), "ESP32_Braille_%s", deviceId);
+  snprintf(deviceTopicPrefix, sizeof(deviceTopicPrefix), "%s/%s/", mqtt_topic, deviceId);
+  snprintf(latencyReportTopic, sizeof(latencyReportTopic), "%s/%s", mqtt_topic_latency_report, deviceId);
+  snprintf(lessonStatusTopic, sizeof(lessonStatusTopic), "%s/%s", mqtt_topic_lesson_status, deviceId);
+  snprintf(quizResultsTopic, sizeof(quizResultsTopic), "%s/%s", mqtt_topic_quiz_results, deviceId);
+  snprintf(localAnnounceTopic, sizeof(localAnnounceTopic), "%s/%s", mqtt_topic_local, deviceId);
+  lessonCacheBegin();
+  
+  mqttPrefs.begin("mqtt", false);
+  if (mqttPrefs.getString("group", mqttGroup, sizeof(mqttGroup)) == 0) {
+    strlcpy(mqttGroup, mqtt_group, sizeof(mqttGroup));
+  }
+  buildGroupTopic();
+  loadPace();
+  LOG_INFO("Topics: %s+, %s+", deviceTopicPrefix, groupTopicPrefix);
+  LOG_INFO("Device ID: %s", deviceId);
 
   // Configure MQTTS
-  espClient.setInsecure();  // Skip certificate verification (for testing)
-  // For production, use: espClient.setCACert(ca_cert);
+  espClient.setCACert(ca_cert);
   
   mqtt_client.setServer(mqtt_server, mqtt_port);
   mqtt_client.setCallback(mqttCallback);
+  localLink.setCallback(localLinkCallback);
   mqtt_client.setKeepAlive(60);
-  mqtt_client.setSocketTimeout(30);
+  mqtt_client.setSocketTimeout(MQTT_CONNECT_TIMEOUT_S);
+  espClient.setHandshakeTimeout(MQTT_CONNECT_TIMEOUT_S);
+
+  esp_vfs_eventfd_config_t eventfdConfig = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+  esp_vfs_eventfd_register(&eventfdConfig);
+  networkWakeFd = eventfd(0, EFD_SUPPORT_ISR);   // Written from the quiz key ISR too
+  Serial.onReceive(wakeNetworkTask);
+  
+  if (QUIZ_KEYS_ENABLED) {
+    for (size_t k = 0; k < QUIZ_KEY_COUNT; k++) {
+      pinMode(QUIZ_KEY_PINS[k].pin, INPUT_PULLUP);
+      attachInterruptArg(digitalPinToInterrupt(QUIZ_KEY_PINS[k].pin), onQuizKeyEdge, (void*)k, CHANGE);
+    }
+  }
+  
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = onActuationTimer;
+  timerArgs.name = "actuation";
+  esp_timer_create(&timerArgs, &actuationTimer);
+  
+  // Start networking first: WiFi associates while the actuation task
+  // brings up the servos on the other core
+  if (startNetwork) {
+    xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                            NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+  }
+  xTaskCreatePinnedToCore(actuationTask, "actuation", ACTUATION_TASK_STACK, nullptr,
+                          ACTUATION_TASK_PRIORITY, &actuationTaskHandle, ACTUATION_TASK_CORE);
 
-  Serial.println("Setup complete!");
+  LOG_INFO("Setup complete!");
 }
 
 void loop() {
-  // Maintain WiFi connection
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi disconnected! Reconnecting...");
-    setupWiFi();
+  // All work happens in networkTask and actuationTask
+  vTaskDelete(nullptr);
+}
+
+// ===== Network Task (core 0) =====
+// Owns WiFi, mqtt_client, the TLS socket and the local link. mqttCallback
+// runs here for both transports and is the only producer for cellQueue.
+void networkTask(void* param) {
+  setupWiFi();
+  
+  for (;;) {
+    uint32_t iterationStartUs = latencyNow();
+    
+    // Maintain WiFi connection (event-driven, non-blocking)
+    serviceWiFi();
+
+    // Maintain MQTT connection (non-blocking, backs off between attempts)
+    serviceMQTT();
+    
+    // Process incoming MQTT messages, including any already decrypted
+    do {
+      mqtt_client.loop();
+    } while (mqtt_client.connected() && espClient.available() > 0);
+    localLink.service(millis());
+    serviceSerialCommands();
+    serviceLessonPlayback();
+    serviceQuiz();
+    serviceAcks();
+    serviceTelemetry();
+    
+    networkLoopMaxUs = max(networkLoopMaxUs, latencyNow() - iterationStartUs);
+    waitForNetworkEvent();
   }
+}
 
-  // Maintain MQTT connection
-  if (!mqtt_client.connected()) {
-    reconnectMQTT();
+// Sleeps until the MQTT or a local link socket is readable, another task calls
+// wakeNetworkTask(), or the next timed job (MQTT retry, keepalive, quiz) is due.
+void waitForNetworkEvent() {
+  unsigned long waitMs = NETWORK_MAX_WAIT_MS;
+  if (mqttState == MQTT_STATE_BACKOFF && wifiState == WIFI_STATE_CONNECTED) {
+    long untilRetry = (long)(mqttNextAttemptAt - millis());
+    waitMs = untilRetry <= 0 ? 0 : min(waitMs, (unsigned long)untilRetry);
+  }
+  long untilQuiz = quizWaitMs();
+  if (untilQuiz >= 0) {
+    waitMs = min(waitMs, (unsigned long)untilQuiz);
+  }
+  
+  fd_set readable;
+  FD_ZERO(&readable);
+  FD_SET(networkWakeFd, &readable);
+  int maxFd = networkWakeFd;
+  int socketFd = mqtt_client.connected() ? espClient.fd() : -1;
+  if (socketFd >= 0) {
+    FD_SET(socketFd, &readable);
+    maxFd = max(maxFd, socketFd);
+  }
+  localLink.addFds(readable, maxFd);
+  
+  struct timeval timeout = {(time_t)(waitMs / 1000), (suseconds_t)(waitMs % 1000) * 1000};
+  if (select(maxFd + 1, &readable, nullptr, nullptr, &timeout) > 0 && FD_ISSET(networkWakeFd, &readable)) {
+    uint64_t count;
+    read(networkWakeFd, &count, sizeof(count));
   }
+}
+
+// Safe from any task (WiFi events, UART events, actuation) and ISR
+void wakeNetworkTask() {
+  uint64_t one = 1;
+  write(networkWakeFd, &one, sizeof(one));
+}
+
+void wakeActuationTask() {
+  if (actuationTaskHandle) {
+    xTaskNotifyGive(actuationTaskHandle);
+  }
+}
+
+// ===== Actuation Task (core 1) =====
+// Owns the servos and is the only consumer of cellQueue.
+void actuationTask(void* param) {
+  initDisplay();
   
-  mqtt_client.loop();  // Process incoming MQTT messages
-  delay(10);           // Small delay to prevent watchdog issues
+  for (;;) {
+    if (connectFlashPending.exchange(false)) {
+      // Visual confirmation of MQTT connect - briefly raise all servos,
+      // restoring the line as soon as they have settled
+      uint8_t shown[DISPLAY_CELLS];
+      memcpy(shown, display.line(), sizeof(shown));
+      uint8_t raised[DISPLAY_CELLS];
+      memset(raised, 0b111111, sizeof(raised));
+      display.show(raised, millis());
+      for (;;) {
+        // The dots start staggered, so wait for each start, then the settle
+        unsigned long wakeAt = display.settledAt();
+        bool starting = display.nextStartAt(wakeAt);
+        long wait = (long)(wakeAt - millis());
+        if (wait > 0) {
+          vTaskDelay(pdMS_TO_TICKS(wait));
+        }
+        if (!starting) {
+          break;
+        }
+        display.service(millis());
+      }
+      display.show(shown, millis());
+    }
+    
+    // The connect flash above deliberately waits, so timing starts here
+    uint32_t iterationStartUs = latencyNow();
+    
+    if (calibrationChanged.exchange(false)) {
+      display.commandAll(display.line(), millis());   // Every dot moves to its new pulse width
+    }
+    
+    display.service(millis());   // Staggered dot starts (see Inrush Budget)
+    playNextLine();  // Show the next queued cells once the current line has dwelled
+    serviceIdleRelease();
+    
+    uint32_t iterationUs = latencyNow() - iterationStartUs;
+    if (iterationUs > actuationLoopMaxUs.load(std::memory_order_relaxed)) {
+      actuationLoopMaxUs.store(iterationUs, std::memory_order_relaxed);
+    }
+    ulTaskNotifyTake(pdTRUE, armActuationTimer());
+  }
+}
+
+// Arms the timer for the next deadline and returns how long to block on
+// the notification: not at all if it is already due, else until woken by
+// the timer or by new work. An early wake only re-arms the timer.
+TickType_t armActuationTimer() {
+  esp_timer_stop(actuationTimer);
+  long waitMs = actuationWaitMs();
+  if (waitMs < 0) {
+    return portMAX_DELAY;
+  }
+  // Deadlines are in millis(); fire at the start of that ms
+  int64_t waitUs = (int64_t)waitMs * 1000 - esp_timer_get_time() % 1000;
+  if (waitUs <= 0) {
+    return 0;
+  }
+  esp_timer_start_once(actuationTimer, waitUs);
+  return portMAX_DELAY;
+}
+
+// Runs in the esp_timer task
+void onActuationTimer(void* arg) {
+  wakeActuationTask();
+}
+
+// Time until the next staggered dot start, the next line (or gap) if more
+// cells are queued, or the settled servos are due for release; -1 if none
+// applies.
+long actuationWaitMs() {
+  unsigned long dueAt = 0;
+  bool due = linePlayer.nextDueAt(dueAt);
+  unsigned long startAt;
+  if (display.nextStartAt(startAt)) {
+    if (!due || (long)(startAt - dueAt) < 0) {
+      dueAt = startAt;
+    }
+    due = true;
+  }
+  if (SERVO_IDLE_RELEASE && !display.released()) {
+    unsigned long releaseAt = display.settledAt() + SERVO_RELEASE_DELAY_MS;
+    if (!due || (long)(releaseAt - dueAt) < 0) {
+      dueAt = releaseAt;
+    }
+    due = true;
+  }
+  if (!due) {
+    return -1;
+  }
+  long waitMs = (long)(dueAt - millis());
+  return waitMs <= 0 ? 0 : waitMs;
+}
+
+// ===== Display Init and RTC Mirror =====
+// Servo positions are unknown at boot, so every dot is commanded: to the
+// mirrored line after a warm reset (the dots barely move), else blank.
+void initDisplay() {
+  loadServoCalibration();
+  displayOutput().begin();
+  uint8_t line[DISPLAY_CELLS] = {};
+  if (warmBoot) {
+    memcpy(line, rtcDisplayState.line, sizeof(line));
+  }
+  display.commandAll(line, millis());
+  saveDisplayState();
+  LOG_INFO("✓ Servos initialized (%u cells)", (unsigned)DISPLAY_CELLS);
+}
+
+void serviceIdleRelease() {
+  if (!SERVO_IDLE_RELEASE || display.released() ||
+      (long)(millis() - (display.settledAt() + SERVO_RELEASE_DELAY_MS)) < 0) {
+    return;
+  }
+  display.release();
+  LOG_DEBUG("Servos released");
+}
+
+void saveDisplayState() {
+  memcpy(rtcDisplayState.line, display.line(), sizeof(rtcDisplayState.line));
+  rtcDisplayState.magic = DISPLAY_STATE_MAGIC;
+  rtcDisplayState.checksum = fnv1a(&rtcDisplayState, offsetof(DisplayState, checksum));
+}
+
+uint32_t fnv1a(const void* data, size_t length) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+// ===== WiFi Cache Helpers =====
+uint32_t wifiCacheChecksum(const WiFiCache& cache) {
+  return fnv1a(&cache, offsetof(WiFiCache, checksum));
+}
+
+bool wifiCacheValid(const WiFiCache& cache) {
+  return cache.magic == WIFI_CACHE_MAGIC && cache.checksum == wifiCacheChecksum(cache);
+}
+
+// Prefer the RTC copy (free to read) and fall back to NVS after a power cycle
+void loadWiFiCache() {
+  if (wifiCacheValid(rtcWiFiCache)) {
+    wifiCache = rtcWiFiCache;
+    return;
+  }
+  WiFiCache stored = {};
+  if (wifiPrefs.getBytes("cache", &stored, sizeof(stored)) == sizeof(stored) && wifiCacheValid(stored)) {
+    wifiCache = stored;
+    rtcWiFiCache = stored;
+  }
+}
+
+// NVS is only rewritten when the AP or lease actually changed
+void saveWiFiCache(const WiFiCache& cache) {
+  rtcWiFiCache = cache;
+  if (memcmp(&cache, &wifiCache, sizeof(cache)) != 0) {
+    wifiPrefs.putBytes("cache", &cache, sizeof(cache));
+  }
+  wifiCache = cache;
+}
+
+void invalidateWiFiCache() {
+  wifiCache.magic = 0;
+  rtcWiFiCache.magic = 0;
+  wifiPrefs.remove("cache");
 }
 
 // ===== WiFi Connection Function =====
+// One-time station setup; the connection itself is tracked by serviceWiFi().
 void setupWiFi() {
-  Serial.print("Connecting to WiFi: ");
-  Serial.println(ssid);
-  
-  // Disconnect and clear previous config
-  WiFi.disconnect(true);
-  delay(1000);
+  wifiPrefs.begin("wifi", false);
+  loadWiFiCache();
   
+  WiFi.persistent(false);        // Credentials live in firmware; skip SDK flash writes
   WiFi.mode(WIFI_STA);
-  WiFi.setAutoReconnect(true);
-  WiFi.begin(ssid, password);
+  WiFi.setAutoReconnect(false);  // Reconnects are handled here, using the cache
+  WiFi.setSleep(WIFI_PS_MIN_MODEM);  // Radio sleeps between DTIM beacons
+  WiFi.onEvent(WiFiEvent);
   
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 40) {  // Increased timeout
-    delay(500);
-    Serial.print(".");
-    
-    // Print detailed status every 5 seconds
-    if (attempts % 10 == 0 && attempts > 0) {
-      Serial.println();
-      Serial.print("Status: ");
-      switch (WiFi.status()) {
-        case WL_IDLE_STATUS: Serial.println("Idle"); break;
-        case WL_NO_SSID_AVAIL: Serial.println("SSID not found!"); break;
-        case WL_SCAN_COMPLETED: Serial.println("Scan completed"); break;
-        case WL_CONNECT_FAILED: Serial.println("Connection failed!"); break;
-        case WL_CONNECTION_LOST: Serial.println("Connection lost"); break;
-        case WL_DISCONNECTED: Serial.println("Disconnected"); break;
-        default: Serial.println("Unknown"); break;
-      }
-    }
-    attempts++;
+  beginWiFi(wifiCacheValid(wifiCache));
+}
+
+// Joins directly on the cached BSSID/channel (no scan), optionally with the
+// cached lease as a static IP (no DHCP); otherwise a full scan + DHCP.
+void beginWiFi(bool useCache) {
+  wifiFastAttempt = useCache;
+  wifiState = WIFI_STATE_CONNECTING;
+  wifiAttemptStartedAt = millis();
+  
+  LOG_INFO("Connecting to WiFi: %s%s", ssid, useCache ? " (cached AP)" : "");
+  
+  if (useCache && WIFI_REUSE_IP_LEASE) {
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+  } else {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
   }
   
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\n✓ WiFi connected!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
-    Serial.print("Signal strength (RSSI): ");
-    Serial.print(WiFi.RSSI());
-    Serial.println(" dBm");
-    Serial.print("MAC Address: ");
-    Serial.println(WiFi.macAddress());
+  if (useCache) {
+    WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
   } else {
-    Serial.println("\n✗ WiFi connection failed!");
-    Serial.print("Final status: ");
-    Serial.println(WiFi.status());
-    Serial.println("\nTroubleshooting:");
-    Serial.println("1. Check WiFi name and password");
-    Serial.println("2. Ensure router is on 2.4GHz (ESP32 doesn't support 5GHz)");
-    Serial.println("3. Check router security settings");
-    Serial.println("4. Try moving ESP32 closer to router");
+    WiFi.begin(ssid, password);
   }
 }
 
-// ===== MQTT Reconnection Function =====
-void reconnectMQTT() {
-  while (!mqtt_client.connected()) {
-    Serial.print("Connecting to MQTTS broker...");
-    
-    String clientId = "ESP32_Braille_" + String(random(0xffff), HEX);
-    
-    // Attempt to connect
-    bool connected;
-    if (strlen(mqtt_user) > 0 && strlen(mqtt_password) > 0) {
-      connected = mqtt_client.connect(clientId.c_str(), mqtt_user, mqtt_password);
-    } else {
-      connected = mqtt_client.connect(clientId.c_str());
+// ===== WiFi Event Handler =====
+// Runs on the WiFi event task; only hands the event to the network task.
+void WiFiEvent(WiFiEvent_t event) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      wifiGotIpEvent = true;
+      wakeNetworkTask();
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      wifiLostEvent = true;
+      wakeNetworkTask();
+      break;
+    default:
+      break;
+  }
+}
+
+// ===== WiFi Link State Machine =====
+void serviceWiFi() {
+  if (wifiGotIpEvent.exchange(false)) {
+    onWiFiConnected();
+  }
+  
+  // A disconnect reported before the association that just succeeded is stale
+  if (wifiLostEvent.exchange(false) && WiFi.status() != WL_CONNECTED) {
+    if (wifiState == WIFI_STATE_CONNECTED) {
+      LOG_WARN("WiFi disconnected! Reconnecting...");
+      localLink.disconnect();
+      beginWiFi(wifiCacheValid(wifiCache));
+    } else if (wifiFastAttempt) {
+      LOG_WARN("Cached AP rejected, falling back to full scan");
+      invalidateWiFiCache();
+      beginWiFi(false);
     }
-    
-    if (connected) {
-      Serial.println(" Connected!");
-      Serial.print("✓ Subscribed to topic: ");
-      Serial.println(mqtt_topic);
-      
-      mqtt_client.subscribe(mqtt_topic);
-      
-      // Visual confirmation - briefly raise all servos
-      for (int i = 0; i < 6; i++) {
-        // Servos 1-3: raise to 90°, Servos 4-6: raise to 0° (opposite direction)
-        int raiseAngle = (i < 3) ? 90 : 0;
-        servos[i].write(raiseAngle);
+    // A failed full attempt is retried when it times out below
+  }
+  
+  if (wifiState != WIFI_STATE_CONNECTING) {
+    return;
+  }
+  
+  unsigned long elapsed = millis() - wifiAttemptStartedAt;
+  if (wifiFastAttempt && elapsed > WIFI_FAST_CONNECT_TIMEOUT_MS) {
+    LOG_WARN("Cached AP timed out, falling back to full scan");
+    invalidateWiFiCache();
+    beginWiFi(false);
+  } else if (!wifiFastAttempt && elapsed > WIFI_CONNECT_TIMEOUT_MS) {
+    LOG_ERROR("✗ WiFi connection failed! Final status: %d", (int)WiFi.status());
+    LOG_INFO("Troubleshooting:");
+    LOG_INFO("1. Check WiFi name and password");
+    LOG_INFO("2. Ensure router is on 2.4GHz (ESP32 doesn't support 5GHz)");
+    LOG_INFO("3. Check router security settings");
+    LOG_INFO("4. Try moving ESP32 closer to router");
+    beginWiFi(false);
+  }
+}
+
+void onWiFiConnected() {
+  wifiState = WIFI_STATE_CONNECTED;
+  if (wifiEverConnected) {
+    wifiReconnects++;
+  }
+  wifiEverConnected = true;
+  
+  LOG_INFO("✓ WiFi connected in %lu ms", millis() - wifiAttemptStartedAt);
+  // Formatted here rather than through String, which allocates
+  IPAddress ip = WiFi.localIP();
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  LOG_INFO("IP address: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  LOG_INFO("Signal strength (RSSI): %d dBm", WiFi.RSSI());
+  LOG_INFO("MAC Address: %02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  
+  WiFiCache cache = {};
+  cache.magic = WIFI_CACHE_MAGIC;
+  memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+  cache.channel = WiFi.channel();
+  cache.ip = WiFi.localIP();
+  cache.gateway = WiFi.gatewayIP();
+  cache.subnet = WiFi.subnetMask();
+  cache.dns = WiFi.dnsIP(0);
+  cache.checksum = wifiCacheChecksum(cache);
+  saveWiFiCache(cache);
+  
+  if (LOCAL_LINK_ENABLED) {
+    localLink.begin(LOCAL_LINK_PORT, local_link_key);
+  }
+  startClockSync();
+}
+
+// ===== SNTP Clock =====
+// lwIP polls on its own from here on, across WiFi reconnects.
+void startClockSync() {
+  if (sntp_enabled()) {
+    return;
+  }
+  sntp_setoperatingmode(SNTP_OPMODE_POLL);
+  sntp_setservername(0, ntp_server);
+  sntp_set_sync_interval(SNTP_SYNC_INTERVAL_MS);
+  sntp_set_time_sync_notification_cb(onClockSynced);
+  sntp_init();
+}
+
+// Runs in the lwIP task
+void onClockSynced(struct timeval* tv) {
+  clockSynced = true;
+}
+
+// Converts a frame's UTC show-at time to millis(). A late frame is due at
+// once, so a unit that fell behind catches up with the others.
+bool localShowTime(uint64_t showAtUtcMs, uint32_t& showAtMs) {
+  if (!clockSynced) {
+    LOG_DEBUG("Clock not synced, timed frame shown on arrival");
+    return false;
+  }
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  unsigned long nowMs = millis();
+  int64_t leadMs = (int64_t)(showAtUtcMs - ((uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000));
+  if (leadMs > TIMED_FRAME_MAX_LEAD_MS) {
+    LOG_WARN("Timed frame %lld ms ahead, shown on arrival", (long long)leadMs);
+    return false;
+  }
+  if (leadMs < 0) {
+    framesLate++;
+    LOG_DEBUG("Timed frame %lld ms late", (long long)-leadMs);
+    leadMs = 0;
+  }
+  showAtMs = nowMs + leadMs;
+  return true;
+}
+
+// ===== MQTT Connection State Machine =====
+// Polled from the network task; never blocks beyond a single connect
+// attempt (bounded by MQTT_CONNECT_TIMEOUT_S).
+void serviceMQTT() {
+  switch (mqttState) {
+    case MQTT_STATE_CONNECTED:
+      if (mqtt_client.connected()) {
+        return;
       }
-      delay(500);
-      setAllServosLowered();
-      
-    } else {
-      Serial.print(" Failed, rc=");
-      Serial.print(mqtt_client.state());
-      Serial.println(" Retrying in 5 seconds...");
-      delay(5000);
+      LOG_WARN("MQTT connection lost, rc=%d", mqtt_client.state());
+      mqttBackoffMs = MQTT_BACKOFF_MIN_MS;
+      scheduleMQTTRetry();
+      return;
+
+    case MQTT_STATE_BACKOFF:
+      if ((long)(millis() - mqttNextAttemptAt) < 0 || wifiState != WIFI_STATE_CONNECTED) {
+        return;
+      }
+      if (reconnectMQTT()) {
+        mqttState = MQTT_STATE_CONNECTED;
+        mqttBackoffMs = MQTT_BACKOFF_MIN_MS;
+      } else {
+        scheduleMQTTRetry();
+        mqttBackoffMs = min(mqttBackoffMs * 2, MQTT_BACKOFF_MAX_MS);
+      }
+      return;
+  }
+}
+
+// Waits between half and all of the current backoff ("equal jitter") so
+// devices that dropped together spread their retries out.
+void scheduleMQTTRetry() {
+  unsigned long wait = mqttBackoffMs / 2 + random(mqttBackoffMs / 2 + 1);
+  mqttNextAttemptAt = millis() + wait;
+  mqttState = MQTT_STATE_BACKOFF;
+  
+  LOG_INFO("Retrying MQTT in %lu ms", wait);
+}
+
+// ===== MQTT Connect Attempt =====
+bool reconnectMQTT() {
+  LOG_INFO("Connecting to MQTTS broker as %s...", mqttClientId);
+  
+  // The will clears the local link announcement if the device drops off
+  // without a chance to withdraw it
+  bool credentials = strlen(mqtt_user) > 0 && strlen(mqtt_password) > 0;
+  bool connected = mqtt_client.connect(mqttClientId, credentials ? mqtt_user : nullptr,
+                                       credentials ? mqtt_password : nullptr,
+                                       LOCAL_LINK_ENABLED ? localAnnounceTopic : nullptr, 0, true, "",
+                                       MQTT_CLEAN_SESSION);
+  
+  if (!connected) {
+    LOG_WARN("MQTT connect failed, rc=%d", mqtt_client.state());
+    return false;
+  }
+  
+  // Harmless when the broker kept the session; required when it did not
+  mqtt_client.subscribe(mqtt_topic, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_grade2, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_cells, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_calibrate, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_lesson, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_play, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_quiz, MQTT_CONTENT_QOS);
+  mqtt_client.subscribe(mqtt_topic_latency);   // Stale report requests aren't worth replaying
+  
+  // One wildcard each for the device and group scopes
+  char filter[sizeof(groupTopicPrefix) + 1];
+  snprintf(filter, sizeof(filter), "%s+", deviceTopicPrefix);
+  mqtt_client.subscribe(filter, MQTT_CONTENT_QOS);
+  snprintf(filter, sizeof(filter), "%s+", groupTopicPrefix);
+  mqtt_client.subscribe(filter, MQTT_CONTENT_QOS);
+  LOG_INFO("✓ MQTT connected, subscribed to %s/..., %s+ and %s+",
+           mqtt_topic, deviceTopicPrefix, groupTopicPrefix);
+  announceLocalLink();   // The address may have changed with the WiFi lease
+  
+  // Visual confirmation is played by the actuation task, only for the
+  // first connect after a cold boot so reconnects never disturb a lesson
+  if (!mqttEverConnected && !warmBoot) {
+    connectFlashPending = true;
+    wakeActuationTask();
+  }
+  
+  if (mqttEverConnected) {
+    mqttReconnects++;
+  }
+  mqttEverConnected = true;
+  telemetryLastAt = millis();    // First report one interval after connecting
+  return true;
+}
+
+// ===== MQTT Topic Parsing =====
+// Splits a topic into its scope and message kind (see MQTT Topics above).
+bool parseTopic(const char* topic, uint8_t& scope, const char*& kind) {
+  size_t deviceLen = strlen(deviceTopicPrefix);
+  size_t groupLen = strlen(groupTopicPrefix);
+  size_t rootLen = strlen(mqtt_topic);
+  if (strncmp(topic, deviceTopicPrefix, deviceLen) == 0) {
+    scope = CELL_ACK_SCOPE_DEVICE;
+    kind = topic + deviceLen;
+  } else if (strncmp(topic, groupTopicPrefix, groupLen) == 0) {
+    scope = CELL_ACK_SCOPE_GROUP;
+    kind = topic + groupLen;
+  } else if (strcmp(topic, mqtt_topic) == 0) {
+    scope = CELL_ACK_SCOPE_BROADCAST;
+    kind = MQTT_KIND_TEXT;
+  } else if (strncmp(topic, mqtt_topic, rootLen) == 0 && topic[rootLen] == '/') {
+    scope = CELL_ACK_SCOPE_BROADCAST;
+    kind = topic + rootLen + 1;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void buildGroupTopic() {
+  snprintf(groupTopicPrefix, sizeof(groupTopicPrefix), "%s/%s/", mqtt_topic_group_root, mqttGroup);
+}
+
+// ===== Group Change Command =====
+// braille/<id>/group with the new group name; persisted in NVS and
+// applied by resubscribing on the current connection.
+void handleGroupCommand(const byte* payload, unsigned int length) {
+  if (length > MQTT_GROUP_MAX || memchr(payload, '/', length) || memchr(payload, '+', length) ||
+      memchr(payload, '#', length)) {
+    LOG_WARN("Invalid group name");
+    return;
+  }
+  char filter[sizeof(groupTopicPrefix) + 1];
+  snprintf(filter, sizeof(filter), "%s+", groupTopicPrefix);
+  mqtt_client.unsubscribe(filter);
+  
+  memcpy(mqttGroup, payload, length);
+  mqttGroup[length] = '\0';
+  mqttPrefs.putString("group", mqttGroup);
+  buildGroupTopic();
+  // Frames from the new group start their own sequence
+  frameSequences[CELL_ACK_SCOPE_GROUP] = FrameSequence();
+  displayAckSent[CELL_ACK_SCOPE_GROUP] = 0;
+  
+  snprintf(filter, sizeof(filter), "%s+", groupTopicPrefix);
+  mqtt_client.subscribe(filter, MQTT_CONTENT_QOS);
+  LOG_INFO("Joined group %s", mqttGroup);
+  announceLocalLink();
+}
+
+// ===== Pace Commands =====
+// A device scope pace config (retained, so it comes back on every
+// connect) or a one-byte learner nudge, both described in pace.h.
+void loadPace() {
+  pacePrefs.begin("pace", false);
+  uint8_t stored[PACE_CONFIG_SIZE];
+  uint8_t speed = paceConfig.speedPercent;
+  if (pacePrefs.getBytes("config", stored, sizeof(stored)) == sizeof(stored) &&
+      parsePaceConfig(stored, sizeof(stored), paceConfig)) {
+    speed = pacePrefs.getUInt("speed", paceConfig.speedPercent);
+    speed = constrain(speed, paceConfig.minSpeedPercent, paceConfig.maxSpeedPercent);
+  }
+  applyPace(speed);
+}
+
+void applyPace(uint8_t speedPercent) {
+  paceTiming = (uint32_t)paceConfig.dwellMs << 16 | paceConfig.gapMs;
+  paceSpeed = (uint16_t)paceConfig.flags << 8 | speedPercent;
+  wakeActuationTask();   // The current line's deadline moves with the pace
+}
+
+void handlePaceCommand(const byte* payload, unsigned int length) {
+  if (length == 1) {
+    uint8_t speed = paceSpeed & 0xFF;
+    if (!paceNudge(paceConfig, payload[0], speed)) {
+      LOG_DEBUG("Pace nudge ignored");
+      return;
     }
+    pacePrefs.putUInt("speed", speed);
+    applyPace(speed);
+    LOG_INFO("Pace nudged to %u%%", speed);
+    return;
+  }
+  
+  PaceConfig config;
+  if (!parsePaceConfig(payload, length, config)) {
+    LOG_WARN("Invalid pace config (%u bytes)", length);
+    return;
+  }
+  // The retained copy arrives again on every connect; it only resets the
+  // learner's nudged speed when the config itself changed
+  uint8_t stored[PACE_CONFIG_SIZE];
+  if (pacePrefs.getBytes("config", stored, sizeof(stored)) == sizeof(stored) &&
+      memcmp(stored, payload, sizeof(stored)) == 0) {
+    return;
   }
+  pacePrefs.putBytes("config", payload, length);
+  pacePrefs.putUInt("speed", config.speedPercent);
+  paceConfig = config;
+  applyPace(config.speedPercent);
+  LOG_INFO("Pace: %u ms per cell, %u ms gap, %u%%", config.dwellMs, config.gapMs, config.speedPercent);
+}
+
+// ===== Local Link Announcement =====
+// Retained, so a backend that starts later still finds every device. An
+// empty retained payload withdraws it while the link is not listening,
+// and the will does the same when the device drops off the broker, so
+// backends stop dialling an address that no longer answers.
+void announceLocalLink() {
+  if (!mqtt_client.connected()) {
+    return;
+  }
+  if (!LOCAL_LINK_ENABLED || !localLink.listening()) {
+    mqtt_client.publish(localAnnounceTopic, nullptr, 0, true);
+    return;
+  }
+  IPAddress ip = WiFi.localIP();
+  char announcement[24 + MQTT_GROUP_MAX];
+  int len = snprintf(announcement, sizeof(announcement), "%u.%u.%u.%u %u %s",
+                     ip[0], ip[1], ip[2], ip[3], LOCAL_LINK_PORT, mqttGroup);
+  mqtt_client.publish(localAnnounceTopic, reinterpret_cast<const uint8_t*>(announcement), len, true);
+}
+
+// Text, cells, lesson play, quiz and pace messages from the local link
+// go to mqttCallback; anything else is dropped
+void localLinkCallback(char* topic, byte* payload, unsigned int length) {
+  static const char* const allowed[] = {MQTT_KIND_TEXT, MQTT_KIND_GRADE2, MQTT_KIND_CELLS,
+                                        MQTT_KIND_PLAY, MQTT_KIND_QUIZ, MQTT_KIND_PACE};
+  uint8_t scope;
+  const char* kind;
+  if (!parseTopic(topic, scope, kind)) {
+    return;
+  }
+  for (const char* k : allowed) {
+    if (strcmp(kind, k) == 0) {
+      mqttCallback(topic, payload, length);
+      return;
+    }
+  }
+  LOG_WARN("Local link: %s not accepted, broker only", topic);
 }
 
 // ===== MQTT Message Callback =====
+// Translates the whole payload into braille cells and queues them for
+// playback, so a word or sentence costs a single publish. Text is
+// uncontracted (braille_table.h), grade2 text is contracted (grade2.h),
+// and cells carries pre-translated frames.
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  Serial.print("Message received on topic: ");
-  Serial.println(topic);
+  uint32_t receivedUs = latencyNow();
+  messagesProcessed++;
+  LOG_DEBUG("Message received on topic: %s", topic);
   
   if (length == 0) {
-    Serial.println("Empty message received");
+    LOG_DEBUG("Empty message received");
     return;
   }
   
-  // Get first character and convert to uppercase
-  char letter = (char)payload[0];
-  if (letter >= 'a' && letter <= 'z') {
-    letter = letter - 32;  // Convert to uppercase
+  uint8_t scope;
+  const char* kind;
+  if (!parseTopic(topic, scope, kind)) {
+    return;
   }
+  bool grade2 = strcmp(kind, MQTT_KIND_GRADE2) == 0;
   
-  Serial.print("Received letter: ");
-  Serial.println(letter);
+  if (strcmp(kind, MQTT_KIND_CELLS) == 0) {
+    handleCellFrame(payload, length, scope, receivedUs);
+    return;
+  }
   
-  // Check if it's a valid letter (A-Z)
-  if (letter >= 'A' && letter <= 'Z') {
-    uint8_t pattern = braillePatterns[letter - 'A'];
-    
-    Serial.print("Braille pattern (binary): ");
-    for (int i = 5; i >= 0; i--) {
-      Serial.print((pattern >> i) & 1);
+  if (strcmp(kind, MQTT_KIND_LESSON) == 0) {
+    handleLessonBundle(payload, length);
+    return;
+  }
+  
+  if (strcmp(kind, MQTT_KIND_PLAY) == 0) {
+    handleLessonPlay(payload, length);
+    return;
+  }
+  
+  if (strcmp(kind, MQTT_KIND_QUIZ) == 0) {
+    handleQuizBundle(payload, length);
+    return;
+  }
+  
+  if (strcmp(kind, MQTT_KIND_GROUP) == 0) {
+    if (scope == CELL_ACK_SCOPE_DEVICE) {
+      handleGroupCommand(payload, length);
     }
-    Serial.println();
-    
-    updateBrailleServos(pattern);
+    return;
+  }
+  
+  if (strcmp(kind, MQTT_KIND_PACE) == 0) {
+    if (scope == CELL_ACK_SCOPE_DEVICE) {
+      handlePaceCommand(payload, length);   // Per learner, so one unit at a time
+    }
+    return;
+  }
+  
+  // Per-unit commands make no sense for a whole classroom
+  if (scope == CELL_ACK_SCOPE_GROUP && strcmp(kind, MQTT_KIND_CALIBRATE) == 0) {
+    return;
+  }
+  
+  if (strcmp(kind, MQTT_KIND_LATENCY) == 0) {
+    if (scope != CELL_ACK_SCOPE_GROUP) {
+      handleLatencyCommand(payload, length);
+    }
+    return;
+  }
+  
+  if (strcmp(kind, MQTT_KIND_CALIBRATE) == 0) {
+    if (handleCalibrationCommand(payload, length)) {
+      calibrationChanged = true;
+      wakeActuationTask();
+    }
+    return;
+  }
+  
+  if (!grade2 && strcmp(kind, MQTT_KIND_TEXT) != 0) {
+    return;   // Unknown kind, or a sub-topic such as the latency report
+  }
+  
+  HeapGuard guard;   // Translation writes straight into cellQueue
+  
+  unsigned int queued = 0;
+  auto enqueue = [&queued, receivedUs](uint8_t cell) {
+    if (!cellQueue.push({cell, 0, receivedUs, 0, 0, 0})) {
+      return false;
+    }
+    if (queued++ == 0) {
+      latencyRecord(LATENCY_DECODE, receivedUs);
+    }
+    return true;
+  };
+  
+  size_t consumed;
+  if (grade2) {
+    consumed = grade2Translate(payload, length, SHOW_CAPITAL_SIGNS, enqueue);
   } else {
-    Serial.println("Invalid letter received (not A-Z)");
-    setAllServosLowered();  // Clear display for invalid input
+    consumed = brailleTranslate(payload, length, SHOW_CAPITAL_SIGNS, enqueue);
   }
+  if (consumed < length) {
+    LOG_WARN("Cell queue full, dropped %u characters", (unsigned)(length - consumed));
+  }
+  if (queued > 0) {
+    latencyRecord(LATENCY_ENQUEUE, receivedUs);
+    wakeActuationTask();
+  }
+  
+  LOG_DEBUG("Queued %u cells (%u pending)", queued, (unsigned)cellQueue.size());
 }
 
-// ===== Update Servo Positions Based on Braille Pattern =====
-void updateBrailleServos(uint8_t pattern) {
-  Serial.println("Updating servos:");
+void saveFrameSequences() {
+  rtcFrameSequence.started = 0;
+  for (size_t scope = 0; scope < FRAME_SCOPES; scope++) {
+    rtcFrameSequence.last[scope] = frameSequences[scope].last();
+    rtcFrameSequence.started |= frameSequences[scope].started() << scope;
+  }
+  rtcFrameSequence.magic = FRAME_SEQUENCE_MAGIC;
+  rtcFrameSequence.checksum = fnv1a(&rtcFrameSequence, offsetof(FrameSequenceState, checksum));
+}
+
+// ===== Binary Cell Frame Handler =====
+// Unpacks cells straight out of the MQTT receive buffer into the queue.
+void handleCellFrame(const byte* payload, unsigned int length, uint8_t scope, uint32_t receivedUs) {
+  HeapGuard guard;
+  CellFrame frame;
+  if (!parseCellFrame(payload, length, frame)) {
+    LOG_WARN("Malformed cell frame (%u bytes)", length);
+    return;
+  }
   
-  for (int i = 0; i < 6; i++) {
-    bool isRaised = (pattern >> i) & 1;
-    int angle;
-    if (i < 3) {
-      // Servos 1-3: 0° lowered, 90° raised
-      angle = isRaised ? 90 : 0;
+  uint16_t missed;
+  if (!frameSequences[scope].accept(frame.sequence, frame.flags & CELL_FRAME_FLAG_SYNC, missed)) {
+    framesDuplicate++;
+    LOG_DEBUG("Duplicate cell frame #%u dropped", frame.sequence);
+    // A resend usually means our ack was lost, so repeat the latest one
+    if (displayAckSent[scope]) {
+      publishCellAck(scope, displayAckSent[scope] & 0xFFFF, 0);
+    }
+    return;
+  }
+  if (missed > 0) {
+    framesMissed += missed;
+    LOG_WARN("Missed %u cell frame(s) before #%u", missed, frame.sequence);
+  }
+  saveFrameSequences();
+  
+  uint32_t showAtMs = 0;
+  bool timed = (frame.flags & CELL_FRAME_FLAG_TIMED) && localShowTime(frame.showAtMs, showAtMs);
+  
+  // The last cell carries the ack, so it is sent once the whole frame is
+  // up; the first one the show-at time
+  uint16_t queued = 0;
+  while (queued < frame.cellCount) {
+    uint8_t flags = (queued + 1 == frame.cellCount ? QUEUED_CELL_ACK : 0) | scope << QUEUED_CELL_SCOPE_SHIFT;
+    if (queued == 0 && timed) {
+      flags |= QUEUED_CELL_TIMED;
+    }
+    QueuedCell cell = {cellFrameCell(frame, queued), frame.dwellMs, receivedUs, frame.sequence, flags, showAtMs};
+    if (!cellQueue.push(cell)) {
+      break;
+    }
+    if (queued++ == 0) {
+      latencyRecord(LATENCY_DECODE, receivedUs);
+    }
+  }
+  if (queued < frame.cellCount) {
+    LOG_WARN("Cell queue full, dropped %u cells of frame #%u", frame.cellCount - queued, frame.sequence);
+    publishCellAck(scope, frame.sequence, CELL_ACK_FLAG_DROPPED);
+  }
+  if (queued > 0) {
+    latencyRecord(LATENCY_ENQUEUE, receivedUs);
+    wakeActuationTask();
+  }
+  
+  LOG_DEBUG("Frame #%u: queued %u cells (%u pending)", frame.sequence, queued, (unsigned)cellQueue.size());
+}
+
+// ===== Lesson Bundles and Play Commands =====
+// Bundles are validated (version hash included) before they touch flash.
+// A play that misses the cache answers LESSON_STATUS_MISS and is kept, so
+// it starts as soon as the sender follows up with the bundle.
+void handleLessonBundle(byte* payload, unsigned int length) {
+  LessonBundle lesson = {};
+  if (!parseLessonBundle(payload, length, lesson) || length > LESSON_MAX_SIZE) {
+    LOG_WARN("Invalid lesson bundle (%u bytes)", length);
+    publishLessonStatus(LESSON_STATUS_INVALID, lesson.id, lesson.hash);
+    return;
+  }
+  if (!lessonCacheContains(lesson.id, lesson.hash)) {
+    if (lessonPlayback.active) {
+      // The sector being replaced may be the one playing
+      lessonPlayback.active = false;
+      lessonCacheClose();
+    }
+    if (!lessonCacheStore(lesson, payload, length)) {
+      publishLessonStatus(LESSON_STATUS_INVALID, lesson.id, lesson.hash);
+      return;
+    }
+  }
+  publishLessonStatus(LESSON_STATUS_STORED, lesson.id, lesson.hash);
+  
+  if (lessonPlayPendingValid && lessonPlayPending.id == lesson.id && lessonPlayPending.hash == lesson.hash) {
+    lessonPlayPendingValid = false;
+    startLessonPlayback(lessonPlayPending);
+  }
+}
+
+void handleLessonPlay(const byte* payload, unsigned int length) {
+  LessonPlay play;
+  if (!parseLessonPlay(payload, length, play)) {
+    LOG_WARN("Invalid lesson play command");
+    return;
+  }
+  startLessonPlayback(play);
+}
+
+bool startLessonPlayback(const LessonPlay& play) {
+  lessonPlayback.active = false;
+  if (!lessonCacheOpen(play.id, play.hash, lessonPlayback.lesson)) {
+    LOG_INFO("Lesson %u (%08x) not cached", (unsigned)play.id, (unsigned)play.hash);
+    lessonPlayPending = play;
+    lessonPlayPendingValid = true;
+    publishLessonStatus(LESSON_STATUS_MISS, play.id, play.hash);
+    return false;
+  }
+  lessonPlayback.offset = 0;
+  CellFrame step;
+  for (uint16_t i = 0; i < play.firstStep; i++) {
+    if (!lessonNextStep(lessonPlayback.lesson, lessonPlayback.offset, step)) {
+      break;
+    }
+  }
+  lessonPlayback.remaining = play.stepCount;
+  lessonPlayback.active = true;
+  publishLessonStatus(LESSON_STATUS_PLAYING, play.id, play.hash);
+  serviceLessonPlayback();
+  return true;
+}
+
+// Queues the next steps while they fit; reads the cells from the mapping
+void serviceLessonPlayback() {
+  if (!lessonPlayback.active) {
+    return;
+  }
+  unsigned int queued = 0;
+  bool finished = false;
+  while (lessonPlayback.remaining > 0) {
+    size_t offset = lessonPlayback.offset;
+    CellFrame step;
+    if (!lessonNextStep(lessonPlayback.lesson, offset, step)) {
+      finished = true;   // End of the lesson
+      break;
+    }
+    if (step.cellCount > cellQueue.capacity()) {
+      LOG_WARN("Lesson step of %u cells skipped, longer than the queue", step.cellCount);
+    } else if (step.cellCount > cellQueue.available()) {
+      queueRoomPending = true;
+      break;
+    } else {
+      uint32_t queuedUs = latencyNow();
+      for (uint16_t i = 0; i < step.cellCount; i++) {
+        cellQueue.push({cellFrameCell(step, i), step.dwellMs, queuedUs, 0, 0, 0});
+      }
+      queued += step.cellCount;
+    }
+    lessonPlayback.offset = offset;
+    if (lessonPlayback.remaining != LESSON_PLAY_ALL) {
+      lessonPlayback.remaining--;
+    }
+  }
+  if (queued > 0) {
+    wakeActuationTask();
+  }
+  if (finished || lessonPlayback.remaining == 0) {
+    lessonPlayback.active = false;
+    lessonCacheClose();
+  }
+}
+
+void publishLessonStatus(LessonStatus status, uint32_t id, uint32_t hash) {
+  uint8_t payload[LESSON_STATUS_SIZE];
+  size_t len = encodeLessonStatus(status, id, hash, payload);
+  publishUpstream(lessonStatusTopic, payload, len);
+}
+
+// ===== Quiz =====
+// A quiz with the id of the one running is a redelivery and ignored. A
+// new one first sends what is left of the results of the last.
+void handleQuizBundle(const byte* payload, unsigned int length) {
+  QuizBundle quiz;
+  if (length > QUIZ_MAX_SIZE || !parseQuizBundle(payload, length, quiz)) {
+    LOG_WARN("Invalid quiz bundle (%u bytes)", length);
+    return;
+  }
+  if (quizRun.active && quizRun.quiz.id == quiz.id) {
+    return;
+  }
+  if (quizResultCount > 0 && !publishQuizResults()) {
+    LOG_WARN("Dropped %u results of quiz %u", quizResultCount, (unsigned)quizRun.quiz.id);
+  }
+  quizResultCount = 0;
+  quizResultsFinished = false;
+  
+  memcpy(quizBuffer, payload, length);   // The MQTT buffer is reused for the next message
+  parseQuizBundle(quizBuffer, length, quizRun.quiz);
+  quizRun.offset = 0;
+  quizRun.index = 0;
+  quizRun.active = quizNextItem(quizRun.quiz, quizRun.offset, quizRun.item);
+  quizRun.promptPending = false;
+  if (!quizRun.active) {
+    return;
+  }
+  LOG_INFO("Quiz %u: %u items", (unsigned)quiz.id, quiz.itemCount);
+  showQuizPrompt(millis());
+}
+
+// Queues the current item's prompt on a line of its own, or keeps it
+// pending until the queue has room
+void showQuizPrompt(unsigned long promptAt) {
+  quizKeys.reset();
+  quizRun.promptAt = promptAt;
+  const CellFrame& prompt = quizRun.item.prompt;
+  if (prompt.cellCount > cellQueue.capacity()) {
+    LOG_WARN("Quiz prompt of %u cells not shown, longer than the queue", prompt.cellCount);
+    quizRun.promptPending = false;
+    return;
+  }
+  if (prompt.cellCount > cellQueue.available()) {
+    quizRun.promptPending = true;
+    queueRoomPending = true;
+    return;
+  }
+  quizRun.promptPending = false;
+  uint32_t queuedUs = latencyNow();
+  for (uint16_t i = 0; i < prompt.cellCount; i++) {
+    cellQueue.push({cellFrameCell(prompt, i), 0, queuedUs, 0, (uint8_t)(i == 0 ? QUEUED_CELL_BREAK : 0), 0});
+  }
+  if (prompt.cellCount > 0) {
+    wakeActuationTask();
+  }
+}
+
+// Checks the answer, queues the expected cell if it was wrong and moves
+// on to the next item
+void answerQuizItem(uint8_t chord, bool skipped) {
+  unsigned long now = millis();
+  bool correct = !skipped && chord == quizRun.item.answer;
+  unsigned long responseMs = (long)(now - quizRun.promptAt) > 0 ? now - quizRun.promptAt : 0;
+  if (quizResultCount < QUIZ_RESULTS_MAX) {
+    if (quizResultCount == 0) {
+      quizResultsSince = now;
+    }
+    QuizResult& result = quizResults[quizResultCount++];
+    result.item = quizRun.index;
+    result.answer = chord | (correct ? QUIZ_RESULT_CORRECT : 0) | (skipped ? QUIZ_RESULT_SKIPPED : 0);
+    result.responseMs = min(responseMs, 0xFFFFUL);
+  } else {
+    LOG_WARN("Quiz result for item %u dropped, %u unsent", quizRun.index, quizResultCount);
+  }
+  LOG_INFO("Quiz item %u: %s in %lu ms", quizRun.index + 1,
+           skipped ? "skipped" : correct ? "correct" : "wrong", responseMs);
+  
+  unsigned long promptAt = now;
+  if (!correct && cellQueue.push({quizRun.item.answer, QUIZ_FEEDBACK_DWELL_MS, latencyNow(), 0,
+                                  QUEUED_CELL_BREAK, 0})) {
+    promptAt += QUIZ_FEEDBACK_DWELL_MS;
+    wakeActuationTask();
+  }
+  if (!quizNextItem(quizRun.quiz, quizRun.offset, quizRun.item)) {
+    quizRun.active = false;
+    quizResultsFinished = true;
+    LOG_INFO("Quiz %u finished", (unsigned)quizRun.quiz.id);
+    return;
+  }
+  quizRun.index++;
+  showQuizPrompt(promptAt);
+}
+
+// Samples keys again once their bouncing is over, turns completed
+// chords into answers and sends the results when a batch is due
+void serviceQuiz() {
+  unsigned long now = millis();
+  uint32_t resample = quizKeysResample.load();
+  for (size_t k = 0; k < QUIZ_KEY_COUNT; k++) {
+    if (!((resample >> k) & 1) || now - quizKeyEdgeAt[k] < QUIZ_DEBOUNCE_MS) {
+      continue;
+    }
+    quizKeysResample.fetch_and(~(1UL << k));
+    uint8_t key = QUIZ_KEY_PINS[k].key;
+    if (digitalRead(QUIZ_KEY_PINS[k].pin) == LOW) {
+      if (!(quizKeysDown.fetch_or(key) & key)) {
+        quizKeysPressed.fetch_or(key);
+      }
     } else {
-      // Servos 4-6: 90° lowered, 0° raised (inverted for opposite rotation)
-      angle = isRaised ? 0 : 90;
+      quizKeysDown.fetch_and(~(uint32_t)key);
     }
-    servos[i].write(angle);
-    
-    Serial.print("  Dot ");
-    Serial.print(i + 1);
-    Serial.print(": ");
-    Serial.println(isRaised ? "RAISED" : "lowered");
   }
   
-  Serial.println("✓ Servos updated successfully");
+  uint8_t chord = 0;
+  QuizKeyEvent event = quizKeys.update(quizKeysDown.load(), quizKeysPressed.exchange(0), chord);
+  if (quizRun.active && quizRun.promptPending) {
+    if (quizRun.item.prompt.cellCount <= cellQueue.available()) {
+      showQuizPrompt((long)(quizRun.promptAt - now) > 0 ? quizRun.promptAt : now);
+    }
+  } else if (quizRun.active && event != QUIZ_KEYS_NONE) {
+    answerQuizItem(chord, event == QUIZ_KEYS_NEXT);
+  }
+  
+  if (quizResultsFinished || quizResultCount >= QUIZ_RESULT_BATCH ||
+      (quizResultCount > 0 && now - quizResultsSince >= QUIZ_RESULT_LINGER_MS)) {
+    publishQuizResults();   // Kept for the next try if it fails
+  }
 }
 
-// ===== Lower All Servos =====
-void setAllServosLowered() {
-  for (int i = 0; i < 6; i++) {
-    // Servos 1-3: 0° lowered, Servos 4-6: 90° lowered (opposite rotation)
-    int lowerAngle = (i < 3) ? 0 : 90;
-    servos[i].write(lowerAngle);
+bool publishQuizResults() {
+  if (!localLink.connected() && !mqtt_client.connected()) {
+    return false;
+  }
+  HeapGuardPause pause;   // lwIP allocates the outgoing buffers
+  uint8_t payload[quizResultsSize(QUIZ_RESULTS_MAX)];
+  size_t len = encodeQuizResults(quizRun.quiz.id, quizResultsFinished ? QUIZ_RESULTS_FLAG_FINISHED : 0,
+                                 quizResults, quizResultCount, payload);
+  if (!publishUpstream(quizResultsTopic, payload, len)) {
+    return false;
+  }
+  quizResultCount = 0;
+  quizResultsFinished = false;
+  return true;
+}
+
+// Until the next key resample or the linger deadline; -1 if neither
+long quizWaitMs() {
+  unsigned long now = millis();
+  long waitMs = -1;
+  uint32_t resample = quizKeysResample.load();
+  for (size_t k = 0; k < QUIZ_KEY_COUNT; k++) {
+    if ((resample >> k) & 1) {
+      long untilSample = (long)(quizKeyEdgeAt[k] + QUIZ_DEBOUNCE_MS - now);
+      untilSample = untilSample < 0 ? 0 : untilSample;
+      waitMs = waitMs < 0 ? untilSample : min(waitMs, untilSample);
+    }
+  }
+  // Only while a send can succeed, or it would spin offline
+  if (quizResultCount > 0 && (localLink.connected() || mqtt_client.connected())) {
+    long untilSend = (long)(quizResultsSince + QUIZ_RESULT_LINGER_MS - now);
+    untilSend = untilSend < 0 ? 0 : untilSend;
+    waitMs = waitMs < 0 ? untilSend : min(waitMs, untilSend);
+  }
+  return waitMs;
+}
+
+// ===== Answer Key ISR =====
+// Runs on every edge of a key; `arg` is its index in QUIZ_KEY_PINS
+void ARDUINO_ISR_ATTR onQuizKeyEdge(void* arg) {
+  size_t k = (size_t)arg;
+  unsigned long now = millis();
+  if (now - quizKeyEdgeAt[k] < QUIZ_DEBOUNCE_MS) {
+    return;   // Bouncing; serviceQuiz samples the pin once it is over
   }
-  Serial.println("All servos lowered");
-}
\ No newline at end of file
+  quizKeyEdgeAt[k] = now;
+  uint8_t key = QUIZ_KEY_PINS[k].key;
+  if (digitalRead(QUIZ_KEY_PINS[k].pin) == LOW) {
+    quizKeysDown.fetch_or(key);
+    quizKeysPressed.fetch_or(key);
+  } else {
+    quizKeysDown.fetch_and(~(uint32_t)key);
+  }
+  quizKeysResample.fetch_or(1UL << k);
+  wakeNetworkTask();
+}
+
+// ===== Latency Report Commands =====
+// Reports go to the log and, when connected, to latencyReportTopic.
+// The JSON is larger than PubSubClient's packet buffer, so it is streamed.
+const size_t LATENCY_REPORT_MAX = 1536;   // Fits every bucket at its widest count
+
+void handleLatencyCommand(const byte* payload, unsigned int length) {
+  if (length == 5 && memcmp(payload, "reset", 5) == 0) {
+    latencyReset();
+    LOG_INFO("Latency histograms reset");
+    return;
+  }
+  
+  latencyLogReport();
+  if (!mqtt_client.connected()) {
+    return;
+  }
+  char report[LATENCY_REPORT_MAX];
+  size_t len = latencyFormatJson(report, sizeof(report));
+  if (len == 0) {
+    LOG_WARN("Latency report exceeds %u bytes", (unsigned)sizeof(report));
+    return;
+  }
+  mqtt_client.beginPublish(latencyReportTopic, len, false);
+  mqtt_client.write(reinterpret_cast<const uint8_t*>(report), len);
+  mqtt_client.endPublish();
+}
+
+// Serial console: "latency" prints the report, "latency reset" clears it
+void serviceSerialCommands() {
+  static char line[32];
+  static size_t lineLen = 0;
+  
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r') {
+      if (lineLen < sizeof(line)) {
+        line[lineLen++] = c;
+      }
+      continue;
+    }
+    if (lineLen > 8 && memcmp(line, "latency ", 8) == 0) {
+      handleLatencyCommand(reinterpret_cast<const byte*>(line + 8), lineLen - 8);
+    } else if (lineLen == 7 && memcmp(line, "latency", 7) == 0) {
+      handleLatencyCommand(nullptr, 0);
+    }
+    lineLen = 0;
+  }
+}
+
+// ===== Display Acknowledgments =====
+void serviceAcks() {
+  for (uint8_t scope = 0; scope < FRAME_SCOPES; scope++) {
+    uint32_t ack = displayAckPending[scope].exchange(0);
+    if (ack) {
+      displayAckSent[scope] = ack;
+      publishCellAck(scope, ack & 0xFFFF, 0);
+    }
+  }
+}
+
+// Without a connection the sender times out and resends; the repeat is
+// dropped as a duplicate and answered with the latest ack
+void publishCellAck(uint8_t scope, uint16_t sequence, uint8_t flags) {
+  if (!localLink.connected() && !mqtt_client.connected()) {
+    return;
+  }
+  HeapGuardPause pause;   // lwIP allocates the outgoing buffers
+  uint8_t payload[CELL_ACK_SIZE];
+  size_t len = encodeCellAck(sequence, flags | scope << CELL_ACK_SCOPE_SHIFT, cellQueue.available(), payload);
+  if (!publishUpstream(ackTopic, payload, len)) {
+    LOG_WARN("Ack for frame #%u not sent", sequence);
+  }
+}
+
+// Replies go back the way commands come in: over the local link while a
+// backend is connected to it, else through the broker
+bool publishUpstream(const char* topic, const uint8_t* payload, size_t length) {
+  if (localLink.connected()) {
+    return localLink.publish(topic, payload, length);
+  }
+  return mqtt_client.connected() && mqtt_client.publish(topic, payload, length);
+}
+
+// ===== Periodic Telemetry =====
+void serviceTelemetry() {
+  unsigned long now = millis();
+  if (!mqtt_client.connected() || now - telemetryLastAt < TELEMETRY_INTERVAL_MS) {
+    return;
+  }
+  
+  TelemetrySample sample = {};
+  sample.uptimeS = now / 1000;
+  sample.freeHeap = ESP.getFreeHeap();
+  sample.minFreeHeap = ESP.getMinFreeHeap();
+  sample.networkLoopMaxUs = networkLoopMaxUs;
+  sample.actuationLoopMaxUs = actuationLoopMaxUs.exchange(0, std::memory_order_relaxed);
+  sample.messages = messagesProcessed;
+  sample.intervalS = (now - telemetryLastAt) / 1000;
+  sample.queueDepth = cellQueue.size();
+  sample.wifiReconnects = wifiReconnects;
+  sample.mqttReconnects = mqttReconnects;
+  sample.rssi = WiFi.RSSI();
+  
+  uint8_t payload[TELEMETRY_SIZE];
+  size_t len = encodeTelemetry(sample, payload);
+  if (!mqtt_client.publish(telemetryTopic, payload, len)) {
+    LOG_WARN("Telemetry publish failed");
+  }
+  
+  telemetryLastAt = now;
+  networkLoopMaxUs = 0;
+  messagesProcessed = 0;
+}
+
+size_t firmwareQueueAvailable() {
+  return cellQueue.available();
+}
+
+// ===== Paced Line Playback =====
+// The pace (line_player.h) is read fresh for each line. The gap is not
+// mirrored to RTC, so a reset restores the line.
+void playNextLine() {
+  uint32_t timing = paceTiming.load(std::memory_order_relaxed);
+  uint16_t speed = paceSpeed.load(std::memory_order_relaxed);
+  LinePace pace = {(uint16_t)(timing >> 16), (uint16_t)(timing & 0xFFFF), (uint8_t)(speed >> 8),
+                   (uint8_t)(speed & 0xFF)};
+  PlayedLine played;
+  if (linePlayer.advance(millis(), pace, played) != LINE_STEP_LINE) {
+    return;
+  }
+  
+  saveDisplayState();
+  uint32_t ack[FRAME_SCOPES] = {};
+  for (size_t c = 0; c < played.count; c++) {
+    const QueuedCell& cell = played.cells[c];
+    latencyRecord(LATENCY_TOTAL, cell.receivedUs);
+    if (cell.flags & QUEUED_CELL_ACK) {
+      ack[(cell.flags >> QUEUED_CELL_SCOPE_SHIFT) & 0b11] = DISPLAY_ACK_PENDING | cell.ackSequence;
+    }
+  }
+  for (size_t scope = 0; scope < FRAME_SCOPES; scope++) {
+    if (ack[scope]) {
+      displayAckPending[scope] = ack[scope];
+      wakeNetworkTask();
+    }
+  }
+  if (queueRoomPending.exchange(false)) {
+    wakeNetworkTask();   // Room for the next lesson steps or quiz prompt
+  }
+}
@@ -0,0 +1,133 @@
+#include "cell_output.h"
+
+#if DISPLAY_DRIVER == DISPLAY_DRIVER_PCA9685
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// ===== PCA9685 Configuration =====
+// Cell c sits on the board at PCA9685_BASE_ADDRESS + c / 2, using channels
+// 0-5 (even cells) or 6-11 (odd cells) for dots 1-6.
+const uint8_t PCA9685_BASE_ADDRESS = 0x40;
+const size_t PCA9685_CELLS_PER_BOARD = 2;
+const int PCA9685_SDA_PIN = 21;
+const int PCA9685_SCL_PIN = 22;
+const uint32_t PCA9685_I2C_CLOCK = 400000;      // Fast mode
+const uint8_t PCA9685_PRESCALE_50HZ = 121;      // 25 MHz / (4096 * 50 Hz) - 1
+
+// Registers and MODE bits
+const uint8_t PCA9685_MODE1 = 0x00;
+const uint8_t PCA9685_MODE2 = 0x01;
+const uint8_t PCA9685_LED0_ON_L = 0x06;
+const uint8_t PCA9685_PRESCALE = 0xFE;
+const uint8_t PCA9685_MODE1_RESTART = 0x80;
+const uint8_t PCA9685_MODE1_AI = 0x20;          // Register auto-increment
+const uint8_t PCA9685_MODE1_SLEEP = 0x10;
+const uint8_t PCA9685_MODE2_OUTDRV = 0x04;      // Totem-pole outputs
+
+const size_t PCA9685_BOARDS = (DISPLAY_CELLS + PCA9685_CELLS_PER_BOARD - 1) / PCA9685_CELLS_PER_BOARD;
+
+// ===== PCA9685 Driver =====
+// writeCell() only stages pulses; flush() sends each changed cell as one
+// auto-increment burst covering its lowest to highest changed channel.
+// release() puts the boards to sleep (outputs off, oscillator stopped);
+// the channel registers are kept, so the next flush() wakes them and
+// restarts PWM with every channel as it was.
+class Pca9685Output : public CellOutput {
+ public:
+  void begin() override {
+    Wire.begin(PCA9685_SDA_PIN, PCA9685_SCL_PIN, PCA9685_I2C_CLOCK);
+    for (size_t b = 0; b < PCA9685_BOARDS; b++) {
+      uint8_t address = PCA9685_BASE_ADDRESS + b;
+      writeRegister(address, PCA9685_MODE1, PCA9685_MODE1_SLEEP);   // Prescale is only writable asleep
+      writeRegister(address, PCA9685_PRESCALE, PCA9685_PRESCALE_50HZ);
+      writeRegister(address, PCA9685_MODE2, PCA9685_MODE2_OUTDRV);
+      wake(address);
+    }
+  }
+
+  void writeCell(size_t cell, const uint16_t pulseUs[6], uint8_t mask) override {
+    if (cell >= DISPLAY_CELLS) {
+      return;
+    }
+    for (int i = 0; i < 6; i++) {
+      if ((mask >> i) & 1) {
+        ticks_[cell][i] = pulseToTicks(pulseUs[i]);
+      }
+    }
+    dirty_[cell] |= mask;
+  }
+
+  void flush() override {
+    if (released_) {
+      bool staged = false;
+      for (size_t cell = 0; cell < DISPLAY_CELLS; cell++) {
+        staged |= dirty_[cell] != 0;
+      }
+      if (!staged) {
+        return;
+      }
+      for (size_t b = 0; b < PCA9685_BOARDS; b++) {
+        wake(PCA9685_BASE_ADDRESS + b);
+      }
+      released_ = false;
+    }
+
+    for (size_t cell = 0; cell < DISPLAY_CELLS; cell++) {
+      uint8_t mask = dirty_[cell];
+      if (!mask) {
+        continue;
+      }
+      int first = __builtin_ctz(mask);
+      int last = 31 - __builtin_clz(mask);
+      uint8_t channel = (cell % PCA9685_CELLS_PER_BOARD) * 6 + first;
+
+      Wire.beginTransmission(PCA9685_BASE_ADDRESS + cell / PCA9685_CELLS_PER_BOARD);
+      Wire.write(PCA9685_LED0_ON_L + 4 * channel);
+      for (int i = first; i <= last; i++) {
+        uint8_t regs[4] = {0, 0, (uint8_t)(ticks_[cell][i] & 0xFF), (uint8_t)(ticks_[cell][i] >> 8)};
+        Wire.write(regs, sizeof(regs));   // ON at tick 0, OFF after the pulse
+      }
+      Wire.endTransmission();
+      dirty_[cell] = 0;
+    }
+  }
+
+  void release() override {
+    for (size_t b = 0; b < PCA9685_BOARDS; b++) {
+      writeRegister(PCA9685_BASE_ADDRESS + b, PCA9685_MODE1, PCA9685_MODE1_AI | PCA9685_MODE1_SLEEP);
+    }
+    released_ = true;
+  }
+
+ private:
+  // Leaves sleep and restarts PWM from the retained channel registers
+  static void wake(uint8_t address) {
+    writeRegister(address, PCA9685_MODE1, PCA9685_MODE1_AI);
+    delayMicroseconds(500);                                         // Oscillator start-up
+    writeRegister(address, PCA9685_MODE1, PCA9685_MODE1_AI | PCA9685_MODE1_RESTART);
+  }
+
+  // 4096 ticks per 20 ms period
+  static uint16_t pulseToTicks(uint16_t us) {
+    return (uint32_t)us * 4096 / 20000;
+  }
+
+  static void writeRegister(uint8_t address, uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
+  }
+
+  uint16_t ticks_[DISPLAY_CELLS][6] = {};
+  uint8_t dirty_[DISPLAY_CELLS] = {};
+  bool released_ = false;
+};
+
+CellOutput& displayOutput() {
+  static Pca9685Output output;
+  return output;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <string.h>
+#include <Preferences.h>
+#include "log.h"
+#include "servo_calibration.h"
+
+const int RAISED_ANGLE = 90;    // Servo angle for raised dot (active)
+const int LOWERED_ANGLE = 0;    // Servo angle for lowered dot (inactive)
+const uint32_t CALIBRATION_MAGIC = 0xCA1B0001;
+
+struct StoredCalibration {
+  uint32_t magic;
+  uint16_t pulseUs[DISPLAY_CELLS][6][2];
+};
+
+uint16_t dotPulseUs[DISPLAY_CELLS][6][2];
+
+static Preferences calibrationPrefs;
+
+static uint16_t angleToPulseUs(int angle) {
+  return SERVO_MIN_PULSE_US + (uint32_t)(SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US) * angle / 180;
+}
+
+static bool pulseInRange(uint16_t us) {
+  return us >= SERVO_MIN_PULSE_US && us <= SERVO_MAX_PULSE_US;
+}
+
+static void setDefaultCalibration() {
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    for (int i = 0; i < 6; i++) {
+      // The servos on bits 3-5 (dots 3-1) are mounted with opposite rotation
+      bool inverted = i >= 3;
+      dotPulseUs[c][i][0] = angleToPulseUs(inverted ? RAISED_ANGLE : LOWERED_ANGLE);
+      dotPulseUs[c][i][1] = angleToPulseUs(inverted ? LOWERED_ANGLE : RAISED_ANGLE);
+    }
+  }
+}
+
+static void saveServoCalibration() {
+  StoredCalibration stored;
+  stored.magic = CALIBRATION_MAGIC;
+  memcpy(stored.pulseUs, dotPulseUs, sizeof(stored.pulseUs));
+  calibrationPrefs.putBytes("pulses", &stored, sizeof(stored));
+}
+
+void loadServoCalibration() {
+  setDefaultCalibration();
+  calibrationPrefs.begin("servo", false);
+
+  // A table saved for a different number of cells is ignored
+  StoredCalibration stored;
+  if (calibrationPrefs.getBytesLength("pulses") != sizeof(stored) ||
+      calibrationPrefs.getBytes("pulses", &stored, sizeof(stored)) != sizeof(stored) ||
+      stored.magic != CALIBRATION_MAGIC) {
+    LOG_INFO("Servo calibration: defaults");
+    return;
+  }
+  for (size_t c = 0; c < DISPLAY_CELLS; c++) {
+    for (int i = 0; i < 6; i++) {
+      if (!pulseInRange(stored.pulseUs[c][i][0]) || !pulseInRange(stored.pulseUs[c][i][1])) {
+        LOG_WARN("Stored servo calibration out of range, using defaults");
+        return;
+      }
+    }
+  }
+  memcpy(dotPulseUs, stored.pulseUs, sizeof(dotPulseUs));
+  LOG_INFO("Servo calibration: loaded from NVS");
+}
+
+void resetServoCalibration() {
+  setDefaultCalibration();
+  calibrationPrefs.remove("pulses");
+}
+
+bool setDotCalibration(int cell, int bit, uint16_t raisedUs, uint16_t loweredUs) {
+  if (cell < 0 || cell >= (int)DISPLAY_CELLS || bit < 0 || bit >= 6 ||
+      !pulseInRange(raisedUs) || !pulseInRange(loweredUs)) {
+    return false;
+  }
+  dotPulseUs[cell][bit][0] = loweredUs;
+  dotPulseUs[cell][bit][1] = raisedUs;
+  saveServoCalibration();
+  return true;
+}
+
+bool handleCalibrationCommand(const uint8_t* payload, size_t length) {
+  char command[32];
+  if (length >= sizeof(command)) {
+    LOG_WARN("Calibration command too long");
+    return false;
+  }
+  memcpy(command, payload, length);
+  command[length] = '\0';
+
+  if (strcmp(command, "reset") == 0) {
+    resetServoCalibration();
+    LOG_INFO("Servo calibration reset to defaults");
+    return true;
+  }
+
+  int cell = 1;
+  int dot;
+  unsigned raisedUs;
+  unsigned loweredUs;
+  int fields = sscanf(command, "%d %d %u %u", &cell, &dot, &raisedUs, &loweredUs);
+  if (fields == 3) {
+    // Short form without a cell number: the fields shift left by one
+    loweredUs = raisedUs;
+    raisedUs = dot;
+    dot = cell;
+    cell = 1;
+  }
+  if ((fields != 3 && fields != 4) ||
+      raisedUs > SERVO_MAX_PULSE_US || loweredUs > SERVO_MAX_PULSE_US ||
+      !setDotCalibration(cell - 1, 6 - dot, raisedUs, loweredUs)) {
+    LOG_WARN("Invalid calibration command: %s", command);
+    return false;
+  }
+  LOG_INFO("Cell %d dot %d calibrated: raised %u us, lowered %u us", cell, dot, raisedUs, loweredUs);
+  return true;
+}
@@ -0,0 +1,105 @@
+#include "cell_output.h"
+
+#if DISPLAY_DRIVER == DISPLAY_DRIVER_SERVO_PINS
+
+#include <Arduino.h>
+#include <driver/ledc.h>
+#include "servo_calibration.h"
+
+// ===== Servo Configuration =====
+// 6 servos representing 6 Braille dots
+// Dot numbering (standard Braille):
+//   1 • • 4
+//   2 • • 5
+//   3 • • 6
+const int SERVO_PINS[6] = {18, 19, 21, 22, 23, 25};  // GPIO pins for servos 1-6
+
+// ===== LEDC Servo Driver =====
+// All six dots are high-speed LEDC channels on one 50 Hz timer. writeCell()
+// only stages duty values; flush() sets every channel's duty_start back to
+// back, so the new duties latch together at the start of the next PWM
+// period and the dots of a cell start moving on the same edge.
+// release() stops the channels with the output held low; the duties stay
+// configured, so the next flush() only has to restart every channel.
+const ledc_mode_t SERVO_LEDC_MODE = LEDC_HIGH_SPEED_MODE;
+const ledc_timer_t SERVO_LEDC_TIMER = LEDC_TIMER_0;
+const uint32_t SERVO_PERIOD_US = 20000;                     // 50 Hz
+const ledc_timer_bit_t SERVO_DUTY_RESOLUTION = LEDC_TIMER_16_BIT;
+const uint32_t SERVO_DUTY_MAX = 1UL << 16;                  // ~0.3 µs per tick
+
+static inline uint32_t pulseToDuty(uint16_t pulseUs) {
+  return (uint32_t)pulseUs * SERVO_DUTY_MAX / SERVO_PERIOD_US;
+}
+
+class ServoPinOutput : public CellOutput {
+ public:
+  void begin() override {
+    ledc_timer_config_t timer = {};
+    timer.speed_mode = SERVO_LEDC_MODE;
+    timer.duty_resolution = SERVO_DUTY_RESOLUTION;
+    timer.timer_num = SERVO_LEDC_TIMER;
+    timer.freq_hz = 1000000 / SERVO_PERIOD_US;
+    timer.clk_cfg = LEDC_AUTO_CLK;
+    ledc_timer_config(&timer);
+
+    // Channels start with no output; setup() commands every dot right after
+    for (int i = 0; i < 6; i++) {
+      ledc_channel_config_t channel = {};
+      channel.gpio_num = SERVO_PINS[i];
+      channel.speed_mode = SERVO_LEDC_MODE;
+      channel.channel = (ledc_channel_t)i;
+      channel.timer_sel = SERVO_LEDC_TIMER;
+      channel.duty = 0;
+      channel.hpoint = 0;
+      ledc_channel_config(&channel);
+    }
+  }
+
+  void writeCell(size_t cell, const uint16_t pulseUs[6], uint8_t mask) override {
+    for (int i = 0; i < 6; i++) {
+      if ((mask >> i) & 1) {
+        ledc_set_duty(SERVO_LEDC_MODE, (ledc_channel_t)i, pulseToDuty(pulseUs[i]));
+      }
+    }
+    staged_ |= mask;
+  }
+
+  void flush() override {
+    if (!staged_) {
+      return;
+    }
+    if (released_) {
+      staged_ = 0b111111;
+      released_ = false;
+    }
+    // Keep the latch sequence short and uninterrupted so it cannot
+    // straddle a period boundary because of a task switch or ISR
+    portENTER_CRITICAL(&latchLock_);
+    for (int i = 0; i < 6; i++) {
+      if ((staged_ >> i) & 1) {
+        ledc_update_duty(SERVO_LEDC_MODE, (ledc_channel_t)i);
+      }
+    }
+    portEXIT_CRITICAL(&latchLock_);
+    staged_ = 0;
+  }
+
+  void release() override {
+    for (int i = 0; i < 6; i++) {
+      ledc_stop(SERVO_LEDC_MODE, (ledc_channel_t)i, 0);
+    }
+    released_ = true;
+  }
+
+ private:
+  uint8_t staged_ = 0;   // Channels with a duty waiting to be latched
+  bool released_ = false;
+  portMUX_TYPE latchLock_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+CellOutput& displayOutput() {
+  static ServoPinOutput output;
+  return output;
+}
+
+#endif
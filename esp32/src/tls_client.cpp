@@ -0,0 +1,319 @@
+#include <Arduino.h>
+#include <mbedtls/error.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/platform_util.h>
+#include "log.h"
+#include "tls_client.h"
+
+// ===== TLS Session Cache =====
+// Survives reconnects and warm resets; a power cycle starts with a full
+// handshake. Validated with a magic and checksum like the WiFi cache.
+const uint32_t TLS_SESSION_MAGIC = 0x7E55104E;
+
+struct TlsSessionCache {
+  uint32_t magic;
+  uint32_t length;
+  uint32_t checksum;      // FNV-1a over data[0..length)
+  uint8_t data[TLS_SESSION_CACHE_SIZE];
+};
+
+RTC_NOINIT_ATTR static TlsSessionCache rtcTlsSession;
+
+// mbedtls_ssl_session_save() output starts with the format header (5),
+// start time (8), cipher suite (2), compression (1), session ID length
+// and ID (33) and the master secret (48). A resumed session keeps all of
+// them from the offered one, while the ticket after them may be renewed
+// either way, so comparing this prefix tells a resumption from a full
+// handshake without reading the session's private fields.
+const size_t TLS_SESSION_RESUME_PREFIX = 5 + 8 + 2 + 1 + 33 + 48;
+
+static uint32_t tlsSessionChecksum(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static bool tlsSessionCached() {
+  return rtcTlsSession.magic == TLS_SESSION_MAGIC &&
+         rtcTlsSession.length <= TLS_SESSION_CACHE_SIZE &&
+         rtcTlsSession.checksum == tlsSessionChecksum(rtcTlsSession.data, rtcTlsSession.length);
+}
+
+void TlsClient::clearSessionCache() {
+  rtcTlsSession.magic = 0;
+}
+
+// ===== Socket I/O for mbedtls =====
+static int tlsSend(void* ctx, const unsigned char* buf, size_t len) {
+  WiFiClient* tcp = static_cast<WiFiClient*>(ctx);
+  if (!tcp->connected()) {
+    return MBEDTLS_ERR_NET_CONN_RESET;
+  }
+  size_t n = tcp->write(buf, len);
+  return n > 0 ? (int)n : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+static int tlsRecv(void* ctx, unsigned char* buf, size_t len) {
+  WiFiClient* tcp = static_cast<WiFiClient*>(ctx);
+  if (tcp->available() <= 0) {
+    return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+  }
+  int n = tcp->read(buf, len);
+  return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+static void logTlsError(const char* what, int ret) {
+  char message[80];
+  mbedtls_strerror(ret, message, sizeof(message));
+  LOG_WARN("TLS %s failed: -0x%04x %s", what, -ret, message);
+}
+
+// ===== Client =====
+TlsClient::TlsClient() {
+  mbedtls_entropy_init(&entropy_);
+  mbedtls_ctr_drbg_init(&drbg_);
+  mbedtls_x509_crt_init(&ca_);
+  mbedtls_ssl_config_init(&conf_);
+  mbedtls_ssl_init(&ssl_);
+}
+
+TlsClient::~TlsClient() {
+  stop();
+  mbedtls_ssl_free(&ssl_);
+  mbedtls_ssl_config_free(&conf_);
+  mbedtls_x509_crt_free(&ca_);
+  mbedtls_ctr_drbg_free(&drbg_);
+  mbedtls_entropy_free(&entropy_);
+}
+
+// One-time setup; the CA chain and config are reused by every connection
+bool TlsClient::configure() {
+  if (configured_) {
+    return true;
+  }
+  if (!caPem_) {
+    LOG_ERROR("TLS: no CA certificate set");
+    return false;
+  }
+
+  int ret = mbedtls_ctr_drbg_seed(&drbg_, mbedtls_entropy_func, &entropy_, nullptr, 0);
+  if (ret == 0) {
+    ret = mbedtls_x509_crt_parse(&ca_, reinterpret_cast<const unsigned char*>(caPem_), strlen(caPem_) + 1);
+  }
+  if (ret == 0) {
+    ret = mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (ret != 0) {
+    logTlsError("setup", ret);
+    return false;
+  }
+  mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_ca_chain(&conf_, &ca_, nullptr);
+  mbedtls_ssl_conf_rng(&conf_, mbedtls_ctr_drbg_random, &drbg_);
+  mbedtls_ssl_conf_session_tickets(&conf_, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+  ret = mbedtls_ssl_setup(&ssl_, &conf_);
+  if (ret != 0) {
+    logTlsError("setup", ret);
+    return false;
+  }
+  configured_ = true;
+  return true;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+  LOG_ERROR("TLS: connect by host name, the certificate is checked against it");
+  return 0;
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+  stop();
+  if (!configure()) {
+    return 0;
+  }
+  if (!tcp_.connect(host, port, handshakeTimeoutMs_)) {
+    LOG_WARN("TLS: TCP connect to %s:%u failed", host, port);
+    return 0;
+  }
+
+  mbedtls_ssl_session_reset(&ssl_);
+  mbedtls_ssl_set_hostname(&ssl_, host);
+  mbedtls_ssl_set_bio(&ssl_, &tcp_, tlsSend, tlsRecv, nullptr);
+
+  // Offer the cached session; the server falls back to a full handshake
+  // by itself if it no longer knows it
+  uint8_t offeredPrefix[TLS_SESSION_RESUME_PREFIX];
+  bool offered = false;
+  if (tlsSessionCached() && rtcTlsSession.length >= sizeof(offeredPrefix)) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_session_load(&session, rtcTlsSession.data, rtcTlsSession.length) == 0 &&
+        mbedtls_ssl_set_session(&ssl_, &session) == 0) {
+      memcpy(offeredPrefix, rtcTlsSession.data, sizeof(offeredPrefix));
+      offered = true;
+    } else {
+      clearSessionCache();
+    }
+    mbedtls_ssl_session_free(&session);
+  }
+
+  unsigned long startedAt = millis();
+  if (!handshake()) {
+    if (offered) {
+      clearSessionCache();   // Don't offer it again in case it caused this
+    }
+    mbedtls_platform_zeroize(offeredPrefix, sizeof(offeredPrefix));
+    tcp_.stop();
+    return 0;
+  }
+  secure_ = true;
+
+  // The server may have issued a fresh ticket either way
+  bool saved = saveSession();
+  resumed_ = offered && saved && rtcTlsSession.length >= sizeof(offeredPrefix) &&
+             memcmp(rtcTlsSession.data, offeredPrefix, sizeof(offeredPrefix)) == 0;
+  mbedtls_platform_zeroize(offeredPrefix, sizeof(offeredPrefix));
+
+  LOG_INFO("TLS %s in %lu ms", resumed_ ? "session resumed" : "full handshake", millis() - startedAt);
+  return 1;
+}
+
+bool TlsClient::handshake() {
+  unsigned long startedAt = millis();
+  int ret;
+  while ((ret = mbedtls_ssl_handshake(&ssl_)) != 0) {
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      logTlsError("handshake", ret);
+      uint32_t flags = mbedtls_ssl_get_verify_result(&ssl_);
+      if (flags != 0) {
+        LOG_WARN("TLS: certificate verification flags 0x%x", (unsigned)flags);
+      }
+      return false;
+    }
+    if (millis() - startedAt > handshakeTimeoutMs_) {
+      LOG_WARN("TLS handshake timed out");
+      return false;
+    }
+    vTaskDelay(1);
+  }
+  return true;
+}
+
+// Serializes the negotiated session (with its ticket, if any) into RTC;
+// false if it did not fit
+bool TlsClient::saveSession() {
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  size_t length = 0;
+  bool saved = mbedtls_ssl_get_session(&ssl_, &session) == 0 &&
+               mbedtls_ssl_session_save(&session, rtcTlsSession.data, sizeof(rtcTlsSession.data), &length) == 0;
+  if (saved) {
+    rtcTlsSession.length = length;
+    rtcTlsSession.checksum = tlsSessionChecksum(rtcTlsSession.data, length);
+    rtcTlsSession.magic = TLS_SESSION_MAGIC;
+  } else {
+    LOG_WARN("TLS session not cached (larger than %u bytes?)", (unsigned)TLS_SESSION_CACHE_SIZE);
+    clearSessionCache();
+  }
+  mbedtls_ssl_session_free(&session);
+  return saved;
+}
+
+// A peer that stops reading but stays connected fills the send buffer and
+// every write returns WANT_WRITE; after the handshake timeout without
+// progress the connection is dropped rather than stalling the caller.
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+  if (!secure_) {
+    return 0;
+  }
+  size_t sent = 0;
+  unsigned long progressAt = millis();
+  while (sent < size) {
+    int ret = mbedtls_ssl_write(&ssl_, buf + sent, size - sent);
+    if (ret > 0) {
+      sent += ret;
+      progressAt = millis();
+      continue;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      logTlsError("write", ret);
+      stop();
+      break;
+    }
+    if (millis() - progressAt > handshakeTimeoutMs_) {
+      LOG_WARN("TLS write stalled, %u of %u bytes sent", (unsigned)sent, (unsigned)size);
+      stop();
+      break;
+    }
+    vTaskDelay(1);
+  }
+  return sent;
+}
+
+int TlsClient::available() {
+  if (!secure_) {
+    return 0;
+  }
+  // A zero-length read processes any pending records
+  int ret = mbedtls_ssl_read(&ssl_, nullptr, 0);
+  if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+      logTlsError("read", ret);
+    }
+    stop();
+    return 0;
+  }
+  return (int)mbedtls_ssl_get_bytes_avail(&ssl_) + (peeked_ >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  size_t n = 0;
+  if (peeked_ >= 0) {
+    buf[n++] = peeked_;
+    peeked_ = -1;
+  }
+  if (n < size && available() > 0) {
+    int ret = mbedtls_ssl_read(&ssl_, buf + n, size - n);
+    if (ret > 0) {
+      n += ret;
+    }
+  }
+  return n > 0 ? (int)n : -1;
+}
+
+int TlsClient::peek() {
+  if (peeked_ < 0) {
+    uint8_t b;
+    if (read(&b, 1) == 1) {
+      peeked_ = b;
+    }
+  }
+  return peeked_;
+}
+
+void TlsClient::stop() {
+  if (secure_) {
+    mbedtls_ssl_close_notify(&ssl_);
+    secure_ = false;
+  }
+  peeked_ = -1;
+  tcp_.stop();
+}
+
+uint8_t TlsClient::connected() {
+  if (secure_ && !tcp_.connected() && mbedtls_ssl_get_bytes_avail(&ssl_) == 0 && peeked_ < 0) {
+    stop();
+  }
+  return secure_;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""
+Compare benchmark results (test/test_bench, test/test_native_bench) against a baseline.
+
+Reads the test output on stdin and picks up every "BENCH {json}" line:
+
+    pio test -e nodemcu-32s-bench -v | python test/bench_compare.py --save   # store baseline
+    pio test -e nodemcu-32s-bench -v | python test/bench_compare.py          # compare
+
+Host results go in their own baseline (--baseline test/bench_baseline_native.json).
+
+Exits with 1 if any metric is worse than the baseline by more than --threshold.
+"""
+import argparse
+import json
+import sys
+from pathlib import Path
+
+DEFAULT_BASELINE = Path(__file__).with_name("bench_baseline.json")
+
+# Metric -> True if higher is better
+METRICS = {
+    "cells_per_s": True,
+    "total_p50_us": False,
+    "total_p99_us": False,
+    "decode_p50_us": False,
+    "callback_p50_us": False,
+    "callback_p99_us": False,
+    "jitter_us": False,
+    "loop_max_us": False,
+    "heap_used": False,
+    "heap_min_free": True,
+    "ns_per_op": False,
+    "ops_per_s": True,
+}
+
+
+def read_results(stream):
+    results = {}
+    for line in stream:
+        marker = line.find("BENCH {")
+        if marker < 0:
+            continue
+        result = json.loads(line[marker + len("BENCH "):])
+        results[result["corpus"]] = result
+    return results
+
+
+def compare(baseline, results, threshold):
+    regressions = 0
+    for corpus, result in sorted(results.items()):
+        base = baseline.get(corpus)
+        if base is None:
+            print(f"{corpus}: no baseline")
+            continue
+        for metric, higher_is_better in METRICS.items():
+            old, new = base.get(metric), result.get(metric)
+            if old is None or new is None:
+                continue
+            # Small absolute values (a few µs, 0 bytes) are all noise
+            change = (new - old) / max(abs(old), 1)
+            worse = change < -threshold if higher_is_better else change > threshold
+            if worse:
+                regressions += 1
+            flag = "REGRESSION" if worse else ""
+            print(f"{corpus:16} {metric:18} {old:>10} -> {new:>10} {change:+7.1%} {flag}")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--baseline", type=Path, default=DEFAULT_BASELINE)
+    parser.add_argument("--save", action="store_true", help="store these results as the baseline")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed relative change (0.10 = 10%%)")
+    args = parser.parse_args()
+
+    results = read_results(sys.stdin)
+    if not results:
+        sys.exit("No BENCH lines in the input")
+
+    if args.save:
+        args.baseline.write_text(json.dumps(results, indent=2, sort_keys=True) + "\n")
+        print(f"Saved {len(results)} results to {args.baseline}")
+        return
+
+    if not args.baseline.exists():
+        sys.exit(f"No baseline at {args.baseline}; run with --save first")
+    regressions = compare(json.loads(args.baseline.read_text()), results, args.threshold)
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,23 @@
+#pragma once
+
+// ===== Benchmark Corpora =====
+// Shared by the on-target (test_bench) and host (test_native_bench)
+// benchmarks, so their numbers describe the same text.
+static const char* const LETTERS[] = {
+  "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m",
+  "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z",
+};
+
+static const char* const WORDS[] = {
+  "the", "and", "for", "with", "braille", "reading", "children", "because",
+  "knowledge", "together", "spelling", "question", "little", "people", "friend", "should",
+};
+
+static const char* const SENTENCES[] = {
+  "The quick brown fox jumps over the lazy dog.",
+  "Braille is read by moving the fingers across raised dots.",
+  "Each cell has six dots arranged in two columns of three.",
+  "Children learn the letters first and the contractions later.",
+  "Please read the next line aloud when you are ready.",
+  "Knowledge of braille opens the door to books and music.",
+};
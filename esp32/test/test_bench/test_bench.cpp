@@ -0,0 +1,230 @@
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <unity.h>
+
+#include <algorithm>
+
+#include "braille_table.h"
+#include "cell_frame.h"
+#include "firmware.h"
+#include "grade2.h"
+#include "latency.h"
+#include "../bench_corpus.h"
+
+// ===== On-Target Benchmarks =====
+// Replays fixed corpora through the real message path on the device:
+// mqttCallback() -> translation -> cell queue -> actuation task -> driver.
+// The nodemcu-32s-bench env sets settle and dwell to 0, so playback runs
+// as fast as the firmware allows and the numbers measure the software,
+// not the servos. The network task is not started; this task stands in
+// for it on core 0.
+//
+// Each corpus prints one line "BENCH {json}"; test/bench_compare.py saves
+// those as a baseline and flags regressions against it.
+
+const size_t BENCH_PASSES = 8;              // Times each corpus is replayed
+const size_t BENCH_MESSAGES_MAX = 256;      // Callback timings kept per corpus
+const uint32_t BENCH_TIMEOUT_MS = 30000;    // Per wait for queue space or playback
+
+static uint32_t callbackUs[BENCH_MESSAGES_MAX];
+
+struct BenchRun {
+  const char* corpus;
+  char topic[24];
+  size_t messages;
+  uint32_t cells;
+  uint32_t startedUs;
+  uint32_t freeHeapBefore;
+};
+
+static size_t countCells(const char* text, bool grade2) {
+  size_t cells = 0;
+  auto count = [&cells](uint8_t) {
+    cells++;
+    return true;
+  };
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text);
+  size_t length = strlen(text);
+  if (grade2) {
+    grade2Translate(bytes, length, false, count);
+  } else {
+    brailleTranslate(bytes, length, false, count);
+  }
+  return cells;
+}
+
+// Polls until `done` holds; false on timeout
+template <typename Condition>
+static bool waitFor(Condition done) {
+  uint32_t startedAt = millis();
+  while (!done()) {
+    if (millis() - startedAt > BENCH_TIMEOUT_MS) {
+      return false;
+    }
+    vTaskDelay(1);
+  }
+  return true;
+}
+
+static void beginRun(BenchRun& run, const char* corpus, const char* topic) {
+  run.corpus = corpus;
+  strlcpy(run.topic, topic, sizeof(run.topic));
+  run.messages = 0;
+  run.cells = 0;
+  // Let the previous run's last line go idle so it doesn't count here
+  vTaskDelay(pdMS_TO_TICKS(500));
+  latencyReset();
+  actuationLoopMaxUs = 0;
+  run.freeHeapBefore = ESP.getFreeHeap();
+  run.startedUs = latencyNow();
+}
+
+// Feeds one payload to the firmware as if it had arrived from the broker
+static void deliver(BenchRun& run, uint8_t* payload, size_t length, size_t cells) {
+  TEST_ASSERT_TRUE_MESSAGE(waitFor([cells] { return firmwareQueueAvailable() >= cells; }),
+                           "cell queue did not drain");
+  uint32_t startUs = latencyNow();
+  mqttCallback(run.topic, payload, length);
+  uint32_t us = latencyNow() - startUs;
+  if (run.messages < BENCH_MESSAGES_MAX) {
+    callbackUs[run.messages] = us;
+  }
+  run.messages++;
+  run.cells += cells;
+}
+
+static uint32_t percentile(uint32_t* values, size_t count, uint32_t permille) {
+  if (count == 0) {
+    return 0;
+  }
+  size_t index = (count - 1) * permille / 1000;
+  std::nth_element(values, values + index, values + count);
+  return values[index];
+}
+
+static void endRun(BenchRun& run) {
+  uint32_t cells = run.cells;
+  bool shown = waitFor([cells] { return latencySummary(LATENCY_TOTAL).count >= cells; });
+  uint32_t elapsedUs = latencyNow() - run.startedUs;
+  LatencySummary total = latencySummary(LATENCY_TOTAL);
+  LatencySummary decode = latencySummary(LATENCY_DECODE);
+  size_t timed = std::min(run.messages, BENCH_MESSAGES_MAX);
+  uint32_t callbackP50 = percentile(callbackUs, timed, 500);
+  uint32_t callbackP99 = percentile(callbackUs, timed, 990);
+
+  Serial.printf("BENCH {\"corpus\":\"%s\",\"topic\":\"%s\",\"messages\":%u,\"cells\":%u,"
+                "\"cells_per_s\":%u,\"total_p50_us\":%u,\"total_p99_us\":%u,\"total_max_us\":%u,"
+                "\"decode_p50_us\":%u,\"callback_p50_us\":%u,\"callback_p99_us\":%u,"
+                "\"jitter_us\":%u,\"loop_max_us\":%u,\"heap_used\":%d,\"heap_min_free\":%u,"
+                "\"heap_largest_block\":%u}\n",
+                run.corpus, run.topic, (unsigned)run.messages, (unsigned)cells,
+                (unsigned)(elapsedUs ? (uint64_t)cells * 1000000 / elapsedUs : 0),
+                (unsigned)total.p50Us, (unsigned)total.p99Us, (unsigned)total.maxUs,
+                (unsigned)decode.p50Us, (unsigned)callbackP50, (unsigned)callbackP99,
+                (unsigned)(callbackP99 - callbackP50), (unsigned)actuationLoopMaxUs.load(),
+                (int)(run.freeHeapBefore - ESP.getFreeHeap()), (unsigned)ESP.getMinFreeHeap(),
+                (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
+  TEST_ASSERT_TRUE_MESSAGE(shown, "not every queued cell was shown");
+  TEST_ASSERT_EQUAL_UINT32(cells, total.count);
+}
+
+static void replayText(const char* corpus, const char* topic, const char* const* texts, size_t count,
+                       bool grade2) {
+  static uint8_t payload[128];
+  BenchRun run;
+  beginRun(run, corpus, topic);
+  for (size_t pass = 0; pass < BENCH_PASSES; pass++) {
+    for (size_t i = 0; i < count; i++) {
+      size_t length = strlen(texts[i]);
+      memcpy(payload, texts[i], length);
+      deliver(run, payload, length, countCells(texts[i], grade2));
+    }
+  }
+  endRun(run);
+}
+
+// Packs cells 6 bits each, MSB first, behind a cell_frame.h header
+static size_t encodeFrame(const char* text, uint16_t sequence, uint8_t flags, uint8_t* out, size_t size) {
+  size_t cells = 0;
+  uint8_t* packed = out + CELL_FRAME_HEADER_SIZE;
+  memset(packed, 0, size - CELL_FRAME_HEADER_SIZE);
+  auto pack = [&](uint8_t cell) {
+    size_t bit = cells * 6;
+    if (CELL_FRAME_HEADER_SIZE + bit / 8 + 2 > size) {   // Writes span two bytes
+      return false;
+    }
+    uint16_t shifted = (uint16_t)(cell & 0b111111) << (10 - bit % 8);
+    packed[bit / 8] |= shifted >> 8;
+    packed[bit / 8 + 1] |= shifted & 0xFF;
+    cells++;
+    return true;
+  };
+  brailleTranslate(reinterpret_cast<const uint8_t*>(text), strlen(text), false, pack);
+  out[0] = CELL_FRAME_VERSION;
+  out[1] = flags;
+  out[2] = sequence >> 8;
+  out[3] = sequence;
+  out[4] = 0;   // Device default dwell
+  out[5] = 0;
+  out[6] = cells >> 8;
+  out[7] = cells;
+  return CELL_FRAME_HEADER_SIZE + cellFramePackedSize(cells);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void bench_letters() {
+  replayText("letters", "braille", LETTERS, sizeof(LETTERS) / sizeof(LETTERS[0]), false);
+}
+
+void bench_words() {
+  replayText("words", "braille", WORDS, sizeof(WORDS) / sizeof(WORDS[0]), false);
+}
+
+void bench_words_grade2() {
+  replayText("words_grade2", "braille/grade2", WORDS, sizeof(WORDS) / sizeof(WORDS[0]), true);
+}
+
+void bench_sentences() {
+  replayText("sentences", "braille", SENTENCES, sizeof(SENTENCES) / sizeof(SENTENCES[0]), false);
+}
+
+void bench_sentence_frames() {
+  static uint8_t frame[CELL_FRAME_HEADER_SIZE + 96];
+  BenchRun run;
+  beginRun(run, "sentence_frames", "braille/cells");
+  uint16_t sequence = 0;
+  for (size_t pass = 0; pass < BENCH_PASSES; pass++) {
+    for (const char* text : SENTENCES) {
+      // The first frame resyncs whatever sequence the RTC mirror holds
+      size_t length = encodeFrame(text, sequence, sequence == 0 ? CELL_FRAME_FLAG_SYNC : 0, frame, sizeof(frame));
+      sequence++;
+      deliver(run, frame, length, countCells(text, false));
+    }
+  }
+  endRun(run);
+}
+
+static void benchTask(void* param) {
+  UNITY_BEGIN();
+  RUN_TEST(bench_letters);
+  RUN_TEST(bench_words);
+  RUN_TEST(bench_words_grade2);
+  RUN_TEST(bench_sentences);
+  RUN_TEST(bench_sentence_frames);
+  UNITY_END();
+  vTaskDelete(nullptr);
+}
+
+void setup() {
+  delay(2000);   // The test runner opens the port after reset
+  firmwareSetup(false);
+  // Core 0 at the network task's priority, like a real message stream
+  xTaskCreatePinnedToCore(benchTask, "bench", 8192, nullptr, 1, nullptr, 0);
+}
+
+void loop() {
+  vTaskDelete(nullptr);
+}
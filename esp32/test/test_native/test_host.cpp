@@ -0,0 +1,360 @@
+#include <string.h>
+#include <unity.h>
+
+#include "braille_table.h"
+#include "cell_frame.h"
+#include "cell_queue.h"
+#include "grade2.h"
+#include "host_output.h"
+#include "lesson.h"
+#include "line_display.h"
+#include "line_layout.h"
+#include "line_player.h"
+#include "pace.h"
+#include "quiz.h"
+#include "servo_calibration.h"
+
+// ===== Native Host Tests =====
+// Portable modules against the host drivers: `pio test -e native`.
+static CellQueue<64> queue;
+
+static size_t queueText(const char* text, bool grade2) {
+  auto push = [](uint8_t cell) { return queue.push({cell, 0, 0, 0, 0, 0}); };
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text);
+  return grade2 ? grade2Translate(bytes, strlen(text), false, push)
+                : brailleTranslate(bytes, strlen(text), false, push);
+}
+
+void setUp() {
+  queue.clear();
+  loadServoCalibration();
+}
+
+void tearDown() {}
+
+void test_translate_grade1() {
+  TEST_ASSERT_EQUAL(4, queueText("ab c", false));
+  const uint8_t expected[] = {dots("1"), dots("12"), 0, dots("14")};
+  for (uint8_t pattern : expected) {
+    QueuedCell cell;
+    TEST_ASSERT_TRUE(queue.pop(cell));
+    TEST_ASSERT_EQUAL_UINT8(pattern, cell.pattern);
+  }
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_translate_malformed_utf8() {
+  const bool grades[] = {false, true};
+
+  // A braille code point cut off at the end: one blank, every byte consumed
+  for (bool grade2 : grades) {
+    TEST_ASSERT_EQUAL(3, queueText("a\xE2\xA0", grade2));
+    QueuedCell cell;
+    TEST_ASSERT_EQUAL(2, queue.size());
+    queue.pop(cell);
+    TEST_ASSERT_EQUAL_UINT8(dots("1"), cell.pattern);
+    queue.pop(cell);
+    TEST_ASSERT_EQUAL_UINT8(0, cell.pattern);
+  }
+
+  // A stray lead byte does not swallow the letter after it
+  for (bool grade2 : grades) {
+    TEST_ASSERT_EQUAL(2, queueText("\xC3" "a", grade2));
+    QueuedCell cell;
+    TEST_ASSERT_EQUAL(2, queue.size());
+    queue.pop(cell);
+    TEST_ASSERT_EQUAL_UINT8(0, cell.pattern);
+    queue.pop(cell);
+    TEST_ASSERT_EQUAL_UINT8(dots("1"), cell.pattern);
+  }
+
+  TEST_ASSERT_EQUAL(3, queueText("\xE2\xA0\x81", false));   // U+2801 still shows dot 1
+  QueuedCell cell;
+  queue.pop(cell);
+  TEST_ASSERT_EQUAL_UINT8(dots("1"), cell.pattern);
+}
+
+void test_translate_grade2_contraction() {
+  queueText("the", true);
+  TEST_ASSERT_EQUAL(1, queue.size());
+  QueuedCell cell;
+  queue.pop(cell);
+  TEST_ASSERT_EQUAL_UINT8(dots("2346"), cell.pattern);
+}
+
+void test_queue_full() {
+  for (size_t i = 0; i < queue.capacity(); i++) {
+    TEST_ASSERT_TRUE(queue.push({1, 0, 0, 0, 0, 0}));
+  }
+  TEST_ASSERT_FALSE(queue.push({1, 0, 0, 0, 0, 0}));
+  TEST_ASSERT_EQUAL(0, queue.available());
+}
+
+void test_line_wraps_at_word() {
+  queueText("abc defgh", false);   // 9 cells; "defgh" would be split
+  TEST_ASSERT_EQUAL(4, nextLineLength(queue, 8));
+  TEST_ASSERT_EQUAL(3, nextLineLength(queue, 3));   // Ends right before the space
+  TEST_ASSERT_EQUAL(9, nextLineLength(queue, 16));
+}
+
+void test_timed_frame_starts_its_own_line() {
+  // Timed frame: show-at 0x0102030405060708 ms, one cell (dots 1)
+  const uint8_t payload[] = {CELL_FRAME_VERSION, CELL_FRAME_FLAG_TIMED, 0, 1, 0, 0, 0, 1,
+                             1, 2, 3, 4, 5, 6, 7, 8, 0b10000000};
+  CellFrame frame;
+  TEST_ASSERT_TRUE(parseCellFrame(payload, sizeof(payload), frame));
+  TEST_ASSERT_TRUE(frame.showAtMs == 0x0102030405060708ULL);
+  TEST_ASSERT_EQUAL_UINT8(dots("1"), cellFrameCell(frame, 0));
+  TEST_ASSERT_FALSE(parseCellFrame(payload, CELL_FRAME_HEADER_SIZE + 4, frame));
+
+  queueText("ab", false);
+  TEST_ASSERT_TRUE(queue.push({dots("1"), 0, 0, 0, QUEUED_CELL_TIMED, 1000}));
+  queueText("c", false);
+  TEST_ASSERT_EQUAL(2, nextLineLength(queue, 8));   // "ab", then the timed cell
+}
+
+void test_cell_frame_roundtrip() {
+  // Two cells, dots 1 and 123456, packed MSB first
+  const uint8_t payload[] = {CELL_FRAME_VERSION, 0, 0, 7, 0, 0, 0, 2, 0b10000011, 0b11110000};
+  CellFrame frame;
+  TEST_ASSERT_TRUE(parseCellFrame(payload, sizeof(payload), frame));
+  TEST_ASSERT_EQUAL_UINT16(7, frame.sequence);
+  TEST_ASSERT_EQUAL_UINT8(dots("1"), cellFrameCell(frame, 0));
+  TEST_ASSERT_EQUAL_UINT8(dots("123456"), cellFrameCell(frame, 1));
+}
+
+void test_lesson_bundle() {
+  // Two steps: "a" with the default dwell, then "b" + dots 123456 at 300 ms
+  uint8_t bundle[] = {LESSON_VERSION, 0, 0, 0, 0, 42, 0, 0, 0, 0, 0, 2,
+                      0, 0, 0, 1, 0b10000000,
+                      0x01, 0x2C, 0, 2, 0b11000011, 0b11110000};
+  uint32_t hash = lessonHash(bundle + LESSON_HEADER_SIZE, sizeof(bundle) - LESSON_HEADER_SIZE);
+  for (int i = 0; i < 4; i++) {
+    bundle[6 + i] = hash >> (24 - 8 * i);
+  }
+  LessonBundle lesson;
+  TEST_ASSERT_TRUE(parseLessonBundle(bundle, sizeof(bundle), lesson));
+  TEST_ASSERT_EQUAL_UINT32(42, lesson.id);
+  TEST_ASSERT_EQUAL_UINT16(2, lesson.stepCount);
+
+  size_t offset = 0;
+  CellFrame step;
+  TEST_ASSERT_TRUE(lessonNextStep(lesson, offset, step));
+  TEST_ASSERT_EQUAL_UINT16(1, step.cellCount);
+  TEST_ASSERT_EQUAL_UINT8(dots("1"), cellFrameCell(step, 0));
+  TEST_ASSERT_TRUE(lessonNextStep(lesson, offset, step));
+  TEST_ASSERT_EQUAL_UINT16(300, step.dwellMs);
+  TEST_ASSERT_EQUAL_UINT8(dots("12"), cellFrameCell(step, 0));
+  TEST_ASSERT_EQUAL_UINT8(dots("123456"), cellFrameCell(step, 1));
+  TEST_ASSERT_FALSE(lessonNextStep(lesson, offset, step));
+
+  bundle[sizeof(bundle) - 1] ^= 0x10;   // Any change breaks the version hash
+  TEST_ASSERT_FALSE(parseLessonBundle(bundle, sizeof(bundle), lesson));
+  TEST_ASSERT_FALSE(parseLessonBundle(bundle, sizeof(bundle) - 1, lesson));
+}
+
+void test_pace_scales_dwell_and_clamps_nudges() {
+  // Adaptive, 400 ms per cell, 150 ms gap, 100% nudgeable between 50% and 120%
+  const uint8_t payload[PACE_CONFIG_SIZE] = {PACE_VERSION, PACE_FLAG_ADAPTIVE, 0x01, 0x90, 0, 150, 100, 50, 120};
+  PaceConfig pace;
+  TEST_ASSERT_TRUE(parsePaceConfig(payload, sizeof(payload), pace));
+  TEST_ASSERT_EQUAL_UINT16(400, pace.dwellMs);
+  TEST_ASSERT_EQUAL_UINT16(150, pace.gapMs);
+
+  TEST_ASSERT_EQUAL_UINT32(400, pacedDwellMs(0, pace.flags, pace.dwellMs, 100, 600));
+  TEST_ASSERT_EQUAL_UINT32(300, pacedDwellMs(300, pace.flags, pace.dwellMs, 100, 600));   // Frame dwell wins
+  TEST_ASSERT_EQUAL_UINT32(400, pacedDwellMs(300, PACE_FLAG_OVERRIDE, pace.dwellMs, 100, 600));
+  TEST_ASSERT_EQUAL_UINT32(800, pacedDwellMs(0, pace.flags, pace.dwellMs, 50, 600));
+  TEST_ASSERT_EQUAL_UINT32(600, pacedDwellMs(0, 0, 0, 100, 600));   // Firmware default
+
+  uint8_t speed = pace.speedPercent;
+  TEST_ASSERT_TRUE(paceNudge(pace, '+', speed));
+  TEST_ASSERT_TRUE(paceNudge(pace, '+', speed));
+  TEST_ASSERT_TRUE(paceNudge(pace, '+', speed));
+  TEST_ASSERT_EQUAL_UINT8(120, speed);
+  TEST_ASSERT_TRUE(paceNudge(pace, '=', speed));
+  TEST_ASSERT_EQUAL_UINT8(100, speed);
+  TEST_ASSERT_FALSE(paceNudge(pace, 'x', speed));
+  pace.flags = 0;
+  TEST_ASSERT_FALSE(paceNudge(pace, '-', speed));
+
+  const uint8_t outOfRange[PACE_CONFIG_SIZE] = {PACE_VERSION, 0, 0, 0, 0, 0, 130, 50, 120};
+  TEST_ASSERT_FALSE(parsePaceConfig(outOfRange, sizeof(outOfRange), pace));
+}
+
+void test_quiz_bundle_and_answer_chords() {
+  // Quiz 7: "a" shown, answer dots 1; then no prompt, answer dots 123456
+  const uint8_t bundle[] = {QUIZ_VERSION, 0, 0, 0, 0, 7, 0, 2,
+                            dots("1"), 0, 1, 0b10000000,
+                            dots("123456"), 0, 0};
+  QuizBundle quiz;
+  TEST_ASSERT_TRUE(parseQuizBundle(bundle, sizeof(bundle), quiz));
+  TEST_ASSERT_EQUAL_UINT32(7, quiz.id);
+  size_t offset = 0;
+  QuizItem item;
+  TEST_ASSERT_TRUE(quizNextItem(quiz, offset, item));
+  TEST_ASSERT_EQUAL_UINT8(dots("1"), item.answer);
+  TEST_ASSERT_EQUAL_UINT16(1, item.prompt.cellCount);
+  TEST_ASSERT_EQUAL_UINT8(dots("1"), cellFrameCell(item.prompt, 0));
+  TEST_ASSERT_TRUE(quizNextItem(quiz, offset, item));
+  TEST_ASSERT_EQUAL_UINT16(0, item.prompt.cellCount);
+  TEST_ASSERT_FALSE(quizNextItem(quiz, offset, item));
+  TEST_ASSERT_FALSE(parseQuizBundle(bundle, sizeof(bundle) - 1, quiz));
+
+  // Dots 1 and 2 rolled on, then released one by one
+  QuizKeys keys;
+  uint8_t chord = 0;
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_NONE, keys.update(dots("1"), 0, chord));
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_NONE, keys.update(dots("12"), 0, chord));
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_NONE, keys.update(dots("2"), 0, chord));
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_CHORD, keys.update(0, 0, chord));
+  TEST_ASSERT_EQUAL_UINT8(dots("12"), chord);
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_CHORD, keys.update(0, dots("4"), chord));   // A tap seen only as a press
+  TEST_ASSERT_EQUAL_UINT8(dots("4"), chord);
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_NONE, keys.update(dots("1"), 0, chord));
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_NEXT, keys.update(dots("1") | QUIZ_KEY_NEXT, 0, chord));
+  TEST_ASSERT_EQUAL(QUIZ_KEYS_NONE, keys.update(0, 0, chord));   // Next dropped the chord
+
+  const QuizResult results[] = {{1, (uint8_t)(dots("1") | QUIZ_RESULT_CORRECT), 0xFFFF}};
+  uint8_t payload[quizResultsSize(1)];
+  TEST_ASSERT_EQUAL(sizeof(payload), encodeQuizResults(7, QUIZ_RESULTS_FLAG_FINISHED, results, 1, payload));
+  const uint8_t expected[] = {QUIZ_VERSION, QUIZ_RESULTS_FLAG_FINISHED, 0, 0, 0, 7, 1,
+                              0, 1, (uint8_t)(dots("1") | QUIZ_RESULT_CORRECT), 0xFF, 0xFF};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, payload, sizeof(expected));
+
+  // Each prompt starts a line of its own
+  queueText("ab", false);
+  TEST_ASSERT_TRUE(queue.push({dots("1"), 0, 0, 0, QUEUED_CELL_BREAK, 0}));
+  TEST_ASSERT_EQUAL(2, nextLineLength(queue, 8));
+}
+
+void test_display_commands_only_changed_dots() {
+  HostOutput& output = hostOutput();
+  LineDisplay display(output);
+  uint8_t line[DISPLAY_CELLS] = {};
+  display.commandAll(line, 0);
+  for (unsigned long startAt; display.nextStartAt(startAt);) {
+    display.service(startAt);
+  }
+  uint32_t writes = output.dotWrites;
+  unsigned long now = display.settledAt() + 1000;
+
+  line[0] = dots("1");
+  display.show(line, now);
+  TEST_ASSERT_EQUAL(writes + 1, output.dotWrites);
+  TEST_ASSERT_EQUAL_UINT16(dotPulseUs[0][5][1], output.pulseUs[0][5]);   // Dot 1 is bit 5
+  TEST_ASSERT_EQUAL(now + SERVO_SETTLE_MS, display.settledAt());
+
+  display.show(line, now + 1000);   // Nothing changed, nothing moves
+  TEST_ASSERT_EQUAL(writes + 1, output.dotWrites);
+  TEST_ASSERT_EQUAL(now + 1000, display.settledAt());
+}
+
+void test_display_staggers_dot_starts() {
+  HostOutput& output = hostOutput();
+  LineDisplay display(output);
+  uint8_t line[DISPLAY_CELLS] = {};
+  display.commandAll(line, 0);
+  for (unsigned long startAt; display.nextStartAt(startAt);) {
+    display.service(startAt);
+  }
+  unsigned long now = display.settledAt() + 1000;
+
+  // Every dot rising at once starts within the budget, a few at a time
+  const uint32_t perBatch = SERVO_CURRENT_BUDGET_MA / SERVO_INRUSH_MA;
+  uint32_t writes = output.dotWrites;
+  memset(line, 0b111111, sizeof(line));
+  display.show(line, now);
+  TEST_ASSERT_EQUAL(writes + perBatch, output.dotWrites);
+  unsigned long startAt;
+  TEST_ASSERT_TRUE(display.nextStartAt(startAt));
+  TEST_ASSERT_EQUAL(now + SERVO_INRUSH_MS, startAt);
+
+  while (display.nextStartAt(startAt)) {
+    writes = output.dotWrites;
+    display.service(startAt);
+    TEST_ASSERT_TRUE(output.dotWrites - writes <= perBatch);
+  }
+  TEST_ASSERT_EQUAL_UINT16(dotPulseUs[DISPLAY_CELLS - 1][0][1], output.pulseUs[DISPLAY_CELLS - 1][0]);
+  const uint32_t batches = (DISPLAY_CELLS * 6 + perBatch - 1) / perBatch;
+  TEST_ASSERT_TRUE(display.settledAt() <= now + SERVO_STAGGER_MAX_MS + batches * SERVO_INRUSH_MS + SERVO_SETTLE_MS);
+}
+
+void test_line_player_paces_lines_and_gaps() {
+  HostOutput& output = hostOutput();
+  LineDisplay display(output);
+  LinePlayer<64> player(display, queue, 600);
+  uint8_t blank[DISPLAY_CELLS] = {};
+  display.commandAll(blank, 0);
+  for (unsigned long startAt; display.nextStartAt(startAt);) {
+    display.service(startAt);
+  }
+  unsigned long now = display.settledAt() + 1000;
+
+  // Two cells at half speed after a 300 ms gap
+  const LinePace pace = {400, 300, 0, 50};
+  queueText("ab", false);
+  PlayedLine played;
+  TEST_ASSERT_EQUAL(LINE_STEP_GAP, player.advance(now, pace, played));
+  TEST_ASSERT_EQUAL(300UL, player.dwellMs());
+  unsigned long dueAt;
+  TEST_ASSERT_TRUE(player.nextDueAt(dueAt));
+  TEST_ASSERT_EQUAL(display.settledAt() + 300, dueAt);
+  TEST_ASSERT_EQUAL(LINE_STEP_NONE, player.advance(dueAt - 1, pace, played));
+  TEST_ASSERT_EQUAL(LINE_STEP_LINE, player.advance(dueAt, pace, played));
+  TEST_ASSERT_EQUAL(2, played.count);
+  TEST_ASSERT_EQUAL_UINT8(dots("12"), played.cells[1].pattern);
+  TEST_ASSERT_EQUAL(2 * 800UL, player.dwellMs());
+  TEST_ASSERT_FALSE(player.nextDueAt(dueAt));
+
+  // A timed frame skips the gap and goes up at its show-at time
+  unsigned long showAt = display.settledAt() + 50;
+  TEST_ASSERT_TRUE(queue.push({dots("1"), 0, 0, 0, QUEUED_CELL_TIMED, (uint32_t)showAt}));
+  TEST_ASSERT_TRUE(player.nextDueAt(dueAt));
+  TEST_ASSERT_EQUAL(showAt, dueAt);
+  TEST_ASSERT_EQUAL(LINE_STEP_LINE, player.advance(showAt, pace, played));
+  TEST_ASSERT_EQUAL(1, played.count);
+}
+
+void test_calibration_command_uses_braille_dots() {
+  const char* command = "2 1 2000 700";   // Cell 2, dot 1
+  TEST_ASSERT_TRUE(handleCalibrationCommand(reinterpret_cast<const uint8_t*>(command), strlen(command)));
+  TEST_ASSERT_EQUAL_UINT16(2000, dotPulseUs[1][5][1]);   // Dot 1 is bit 5
+  TEST_ASSERT_EQUAL_UINT16(700, dotPulseUs[1][5][0]);
+
+  command = "6 1900 600";   // First cell, dot 6
+  TEST_ASSERT_TRUE(handleCalibrationCommand(reinterpret_cast<const uint8_t*>(command), strlen(command)));
+  TEST_ASSERT_EQUAL_UINT16(1900, dotPulseUs[0][0][1]);
+
+  command = "7 1900 600";
+  TEST_ASSERT_FALSE(handleCalibrationCommand(reinterpret_cast<const uint8_t*>(command), strlen(command)));
+
+  // Only the exact word resets; a malformed command keeps the trims
+  const char* const notReset[] = {"resetXYZ", "reset 3 1500"};
+  for (const char* text : notReset) {
+    TEST_ASSERT_FALSE(handleCalibrationCommand(reinterpret_cast<const uint8_t*>(text), strlen(text)));
+    TEST_ASSERT_EQUAL_UINT16(2000, dotPulseUs[1][5][1]);
+  }
+  command = "reset";
+  TEST_ASSERT_TRUE(handleCalibrationCommand(reinterpret_cast<const uint8_t*>(command), strlen(command)));
+  TEST_ASSERT_TRUE(dotPulseUs[1][5][1] != 2000);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_translate_grade1);
+  RUN_TEST(test_translate_malformed_utf8);
+  RUN_TEST(test_translate_grade2_contraction);
+  RUN_TEST(test_queue_full);
+  RUN_TEST(test_line_wraps_at_word);
+  RUN_TEST(test_cell_frame_roundtrip);
+  RUN_TEST(test_timed_frame_starts_its_own_line);
+  RUN_TEST(test_lesson_bundle);
+  RUN_TEST(test_pace_scales_dwell_and_clamps_nudges);
+  RUN_TEST(test_quiz_bundle_and_answer_chords);
+  RUN_TEST(test_display_commands_only_changed_dots);
+  RUN_TEST(test_display_staggers_dot_starts);
+  RUN_TEST(test_line_player_paces_lines_and_gaps);
+  RUN_TEST(test_calibration_command_uses_braille_dots);
+  return UNITY_END();
+}
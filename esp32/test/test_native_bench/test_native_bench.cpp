@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include <chrono>
+#include <thread>
+
+#include "braille_table.h"
+#include "cell_queue.h"
+#include "grade2.h"
+#include "host_output.h"
+#include "line_display.h"
+#include "line_player.h"
+#include "servo_calibration.h"
+#include "../bench_corpus.h"
+
+// ===== Host Benchmarks =====
+// Micro-benchmarks of the portable hot paths on a laptop, under the same
+// sanitizers as the native tests: translation of the shared corpora, the
+// SPSC cell queue with a real producer and consumer thread, and paced
+// line playback onto the host driver with the time injected, so no
+// dwell is ever waited out. Run:
+//   pio test -e native-bench -v | python test/bench_compare.py --baseline test/bench_baseline_native.json
+//
+// Each benchmark prints one line "BENCH {json}" with a per-op time, like
+// test_bench on the device. Keep a separate baseline per machine.
+using BenchClock = std::chrono::steady_clock;
+
+const size_t BENCH_PASSES = 2000;             // Times each translation corpus is replayed
+const size_t BENCH_QUEUE_CELLS = 2000000;     // Cells through the queue
+const size_t BENCH_PLAYBACK_PASSES = 200;     // Times the sentences are played
+
+static uint64_t elapsedNs(BenchClock::time_point startedAt) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now() - startedAt).count();
+}
+
+static void report(const char* corpus, const char* op, uint64_t ops, uint64_t ns) {
+  printf("BENCH {\"corpus\":\"%s\",\"op\":\"%s\",\"ops\":%llu,\"ns_per_op\":%llu,\"ops_per_s\":%llu}\n",
+         corpus, op, (unsigned long long)ops, (unsigned long long)(ops ? ns / ops : 0),
+         (unsigned long long)(ns ? ops * 1000000000ULL / ns : 0));
+}
+
+static void translateCorpus(const char* corpus, const char* const* texts, size_t count, bool grade2) {
+  uint64_t cells = 0;
+  uint8_t checksum = 0;
+  auto sink = [&](uint8_t cell) {
+    cells++;
+    checksum ^= cell;
+    return true;
+  };
+  BenchClock::time_point startedAt = BenchClock::now();
+  for (size_t pass = 0; pass < BENCH_PASSES; pass++) {
+    for (size_t i = 0; i < count; i++) {
+      const uint8_t* bytes = reinterpret_cast<const uint8_t*>(texts[i]);
+      size_t length = strlen(texts[i]);
+      size_t consumed = grade2 ? grade2Translate(bytes, length, false, sink)
+                               : brailleTranslate(bytes, length, false, sink);
+      TEST_ASSERT_EQUAL(length, consumed);
+    }
+  }
+  report(corpus, "cell", cells, elapsedNs(startedAt));
+  TEST_ASSERT_TRUE(cells > 0);
+  (void)checksum;
+}
+
+void setUp() {
+  loadServoCalibration();
+}
+
+void tearDown() {}
+
+void bench_translate_words() {
+  translateCorpus("translate_words", WORDS, sizeof(WORDS) / sizeof(WORDS[0]), false);
+}
+
+void bench_translate_sentences() {
+  translateCorpus("translate_sentences", SENTENCES, sizeof(SENTENCES) / sizeof(SENTENCES[0]), false);
+}
+
+void bench_translate_sentences_grade2() {
+  translateCorpus("translate_sentences_grade2", SENTENCES, sizeof(SENTENCES) / sizeof(SENTENCES[0]), true);
+}
+
+// One producer and one consumer thread, as the network and actuation tasks
+void bench_queue_spsc() {
+  static CellQueue<256> queue;
+  queue.clear();
+  uint32_t consumerSum = 0;
+  BenchClock::time_point startedAt = BenchClock::now();
+  std::thread consumer([&consumerSum] {
+    QueuedCell cell;
+    for (size_t popped = 0; popped < BENCH_QUEUE_CELLS;) {
+      if (queue.pop(cell)) {
+        consumerSum += cell.receivedUs;
+        popped++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  uint32_t producerSum = 0;
+  for (size_t i = 0; i < BENCH_QUEUE_CELLS;) {
+    QueuedCell cell = {(uint8_t)(i & 0x3F), 0, (uint32_t)i, 0, 0, 0};
+    if (queue.push(cell)) {
+      producerSum += cell.receivedUs;
+      i++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+  report("queue_spsc", "push_pop", BENCH_QUEUE_CELLS, elapsedNs(startedAt));
+  TEST_ASSERT_EQUAL_UINT32(producerSum, consumerSum);   // Every cell once, none torn
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+// Sentences through LinePlayer -> LineDisplay -> host driver, jumping the
+// clock to each deadline (dot starts, settle, dwell) instead of waiting
+void bench_line_playback() {
+  static CellQueue<256> queue;
+  queue.clear();
+  HostOutput& output = hostOutput();
+  LineDisplay display(output);
+  LinePlayer<256> player(display, queue, 600);
+  const LinePace pace = {0, 100, 0, 100};
+  uint8_t blank[DISPLAY_CELLS] = {};
+  display.commandAll(blank, 0);
+  unsigned long now = 0;
+  uint64_t cells = 0;
+  uint64_t lines = 0;
+  PlayedLine played;
+  auto push = [](uint8_t cell) { return queue.push({cell, 0, 0, 0, 0, 0}); };
+
+  BenchClock::time_point startedAt = BenchClock::now();
+  for (size_t pass = 0; pass < BENCH_PLAYBACK_PASSES; pass++) {
+    for (const char* text : SENTENCES) {
+      brailleTranslate(reinterpret_cast<const uint8_t*>(text), strlen(text), false, push);
+      for (;;) {
+        unsigned long dueAt;
+        bool due = player.nextDueAt(dueAt);
+        unsigned long startAt;
+        if (display.nextStartAt(startAt) && (!due || (long)(startAt - dueAt) < 0)) {
+          now = startAt;
+          display.service(now);
+          continue;
+        }
+        if (!due) {
+          break;
+        }
+        now = (long)(dueAt - now) > 0 ? dueAt : now;
+        if (player.advance(now, pace, played) == LINE_STEP_LINE) {
+          cells += played.count;
+          lines++;
+        }
+      }
+    }
+  }
+  uint64_t ns = elapsedNs(startedAt);
+  report("line_playback", "cell", cells, ns);
+  report("line_playback_lines", "line", lines, ns);
+  TEST_ASSERT_TRUE(queue.empty());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(bench_translate_words);
+  RUN_TEST(bench_translate_sentences);
+  RUN_TEST(bench_translate_sentences_grade2);
+  RUN_TEST(bench_queue_spsc);
+  RUN_TEST(bench_line_playback);
+  return UNITY_END();
+}